@@ -48,6 +48,7 @@
 typedef enum {
   KEY_PREC_B32,
   KEY_PREC_B64,
+  KEY_RNG,
   KEY_MODE = 'm',
   KEY_OPERATOR = 'o',
   KEY_SEED = 's',
@@ -60,12 +61,14 @@ static const char key_prec_b64_str[] = "precision-binary64";
 static const char key_mode_str[] = "mode";
 static const char key_operator_str[] = "operator";
 static const char key_seed_str[] = "seed";
+static const char key_rng_str[] = "rng";
 static const char key_daz_str[] = "daz";
 static const char key_ftz_str[] = "ftz";
 
 typedef struct {
   bool choose_seed;
   uint64_t seed;
+  rng_kind_t rng_kind;
   bool daz;
   bool ftz;
 } t_context;
@@ -119,13 +122,6 @@ typedef enum {
   bitmask_div = '/'
 } bitmask_operations;
 
-static float _bitmask_binary32_binary_op(float a, float b,
-                                         const bitmask_operations op,
-                                         void *context);
-static double _bitmask_binary64_binary_op(double a, double b,
-                                          const bitmask_operations op,
-                                          void *context);
-
 static uint32_t binary32_bitmask = FLOAT_MASK_ONE;
 static uint64_t binary64_bitmask = DOUBLE_MASK_ONE;
 
@@ -185,11 +181,14 @@ static void _set_bitmask_precision_binary64(const int precision) {
  * The following functions are used to calculate the random bitmask
  ***************************************************************/
 
-/* random generator internal state */
-tinymt64_t random_state;
+/* random generator internal state, one per thread */
+static __thread rng_state_t rng_state;
+
+/* random generator configuration shared by all the threads */
+static rng_config_t rng_config = {rng_tinymt64, false, 0};
 
 static uint64_t get_random_mask(void) {
-  return tinymt64_generate_uint64(&random_state);
+  return _rng_generate_uint64(&rng_state, &rng_config);
 }
 
 /* Returns a 32-bits random mask */
@@ -212,8 +211,12 @@ static uint64_t get_random_binary64_mask(void) {
            : get_random_binary64_mask)()
 
 /* Fix the seed of the Random Number Generator */
-static void _set_bitmask_seed(const bool choose_seed, const uint64_t seed) {
-  _set_seed_default(&random_state, choose_seed, seed);
+static void _set_bitmask_seed(const rng_kind_t rng_kind, const bool choose_seed,
+                              const uint64_t seed) {
+  rng_config.kind = rng_kind;
+  rng_config.choose_seed = choose_seed;
+  rng_config.seed = seed;
+  _init_rng_state(&rng_state, &rng_config);
 }
 
 /******************** BITMASK ARITHMETIC FUNCTIONS ********************
@@ -241,14 +244,14 @@ static void _set_bitmask_seed(const bool choose_seed, const uint64_t seed) {
     logger_error("invalid operator %c", OP);                                   \
   };
 
-#define _MUST_NOT_BE_NOISED(X, VIRTUAL_PRECISION)                              \
+#define _MUST_NOT_BE_NOISED(X, VIRTUAL_PRECISION, MODE)                        \
   /* if mode ieee, do not introduce noise */                                   \
-  (BITMASKLIB_MODE == bitmask_mode_ieee) ||				\
-  /* Check that we are not in a special case */				\
-  (FPCLASSIFY(X) != FP_NORMAL && FPCLASSIFY(X) != FP_SUBNORMAL) ||	\
-  /* In RR if the number is representable in current virtual precision, */ \
-  /* do not add any noise if */						\
-  (BITMASKLIB_MODE == bitmask_mode_ob && _IS_REPRESENTABLE(X, VIRTUAL_PRECISION))
+  (MODE == bitmask_mode_ieee) ||                                               \
+  /* Check that we are not in a special case */                                \
+  (FPCLASSIFY(X) != FP_NORMAL && FPCLASSIFY(X) != FP_SUBNORMAL) ||             \
+  /* In RR if the number is representable in current virtual precision, */     \
+  /* do not add any noise if */                                                \
+  (MODE == bitmask_mode_ob && _IS_REPRESENTABLE(X, VIRTUAL_PRECISION))
 
 #define _INEXACT(B)                                                            \
   do {                                                                         \
@@ -282,8 +285,9 @@ static void _set_bitmask_seed(const bool choose_seed, const uint64_t seed) {
     *x = B.type;                                                               \
   } while (0);
 
-static void _inexact_binary32(float *x) {
-  if (_MUST_NOT_BE_NOISED(*x, BITMASKLIB_BINARY32_T)) {
+static __attribute__((always_inline)) inline void
+_inexact_binary32(float *x, const bitmask_mode mode) {
+  if (_MUST_NOT_BE_NOISED(*x, BITMASKLIB_BINARY32_T, mode)) {
     return;
   } else {
     binary32 b32 = {.f32 = *x};
@@ -291,8 +295,9 @@ static void _inexact_binary32(float *x) {
   }
 }
 
-static void _inexact_binary64(double *x) {
-  if (_MUST_NOT_BE_NOISED(*x, BITMASKLIB_BINARY64_T)) {
+static __attribute__((always_inline)) inline void
+_inexact_binary64(double *x, const bitmask_mode mode) {
+  if (_MUST_NOT_BE_NOISED(*x, BITMASKLIB_BINARY64_T, mode)) {
     return;
   } else {
     binary64 b64 = {.f64 = *x};
@@ -300,42 +305,46 @@ static void _inexact_binary64(double *x) {
   }
 }
 
-#define _INEXACT_BINARYN(X)                                                    \
-  _Generic(X, float * : _inexact_binary32, double * : _inexact_binary64)(X)
+#define _INEXACT_BINARYN(X, MODE)                                              \
+  _Generic(X, float *                                                          \
+           : _inexact_binary32, double *                                       \
+           : _inexact_binary64)(X, MODE)
 
-#define _BITMASK_BINARY_OP(A, B, OP, CTX)                                      \
+/* MODE, IS_DAZ and IS_FTZ are compile-time constants in the specialized */
+/* hooks */
+#define _BITMASK_BINARY_OP(A, B, OP, MODE, IS_DAZ, IS_FTZ)                     \
   {                                                                            \
     typeof(A) RES = 0;                                                         \
-    if (((t_context *)CTX)->daz) {                                             \
+    if (IS_DAZ) {                                                              \
       A = DAZ(A);                                                              \
       B = DAZ(B);                                                              \
     }                                                                          \
-    if (BITMASKLIB_MODE == bitmask_mode_ib ||                                  \
-        BITMASKLIB_MODE == bitmask_mode_full) {                                \
-      _INEXACT_BINARYN(&A);                                                    \
-      _INEXACT_BINARYN(&B);                                                    \
+    if (MODE == bitmask_mode_ib || MODE == bitmask_mode_full) {                \
+      _INEXACT_BINARYN(&A, MODE);                                              \
+      _INEXACT_BINARYN(&B, MODE);                                              \
     }                                                                          \
     PERFORM_BIN_OP(OP, RES, A, B);                                             \
-    if (BITMASKLIB_MODE == bitmask_mode_ob ||                                  \
-        BITMASKLIB_MODE == bitmask_mode_full) {                                \
-      _INEXACT_BINARYN(&RES);                                                  \
+    if (MODE == bitmask_mode_ob || MODE == bitmask_mode_full) {                \
+      _INEXACT_BINARYN(&RES, MODE);                                            \
     }                                                                          \
-    if (((t_context *)CTX)->ftz) {                                             \
+    if (IS_FTZ) {                                                              \
       RES = FTZ(RES);                                                          \
     }                                                                          \
     return RES;                                                                \
   }
 
-static float _bitmask_binary32_binary_op(float a, float b,
-                                         const bitmask_operations op,
-                                         void *context) {
-  _BITMASK_BINARY_OP(a, b, op, context)
+static __attribute__((always_inline)) inline float
+_bitmask_binary32_binary_op(float a, float b, const bitmask_operations op,
+                            const bitmask_mode mode, const bool daz,
+                            const bool ftz) {
+  _BITMASK_BINARY_OP(a, b, op, mode, daz, ftz)
 }
 
-static double _bitmask_binary64_binary_op(double a, double b,
-                                          const bitmask_operations op,
-                                          void *context) {
-  _BITMASK_BINARY_OP(a, b, op, context)
+static __attribute__((always_inline)) inline double
+_bitmask_binary64_binary_op(double a, double b, const bitmask_operations op,
+                            const bitmask_mode mode, const bool daz,
+                            const bool ftz) {
+  _BITMASK_BINARY_OP(a, b, op, mode, daz, ftz)
 }
 
 /******************** BITMASK COMPARE FUNCTIONS ********************
@@ -348,41 +357,78 @@ static double _bitmask_binary64_binary_op(double a, double b,
  * point operators
  **********************************************************************/
 
-static void _interflop_add_float(float a, float b, float *c, void *context) {
-  *c = _bitmask_binary32_binary_op(a, b, bitmask_add, context);
-}
-
-static void _interflop_sub_float(float a, float b, float *c, void *context) {
-  *c = _bitmask_binary32_binary_op(a, b, bitmask_sub, context);
-}
-
-static void _interflop_mul_float(float a, float b, float *c, void *context) {
-  *c = _bitmask_binary32_binary_op(a, b, bitmask_mul, context);
-}
-
-static void _interflop_div_float(float a, float b, float *c, void *context) {
-  *c = _bitmask_binary32_binary_op(a, b, bitmask_div, context);
-}
-
-static void _interflop_add_double(double a, double b, double *c,
-                                  void *context) {
-  *c = _bitmask_binary64_binary_op(a, b, bitmask_add, context);
-}
+/* Defines the scalar and vector hooks of OPERATION on TYPE for the mode */
+/* MODE, with denormals-are-zero if DAZ and flush-to-zero if FTZ */
+#define DEFINE_BITMASK_HOOK(OPERATION, TYPE, BINARYN, MODE, DAZ, FTZ)          \
+  static void _interflop_##OPERATION##_##TYPE##_##MODE##_##DAZ##_##FTZ(        \
+      TYPE a, TYPE b, TYPE *c, void *context __attribute__((unused))) {        \
+    *c = _bitmask_##BINARYN##_binary_op(a, b, bitmask_##OPERATION,             \
+                                        bitmask_mode_##MODE, DAZ, FTZ);        \
+  }                                                                            \
+                                                                               \
+  static void _interflop_##OPERATION##_##TYPE##_vec_##MODE##_##DAZ##_##FTZ(    \
+      int width, const TYPE *a, const TYPE *b, TYPE *c,                        \
+      void *context __attribute__((unused))) {                                 \
+    for (int i = 0; i < width; i++)                                            \
+      c[i] = _bitmask_##BINARYN##_binary_op(a[i], b[i], bitmask_##OPERATION,   \
+                                            bitmask_mode_##MODE, DAZ, FTZ);    \
+  }
 
-static void _interflop_sub_double(double a, double b, double *c,
-                                  void *context) {
-  *c = _bitmask_binary64_binary_op(a, b, bitmask_sub, context);
-}
+#define DEFINE_BITMASK_HOOKS(MODE, DAZ, FTZ)                                   \
+  DEFINE_BITMASK_HOOK(add, float, binary32, MODE, DAZ, FTZ)                    \
+  DEFINE_BITMASK_HOOK(sub, float, binary32, MODE, DAZ, FTZ)                    \
+  DEFINE_BITMASK_HOOK(mul, float, binary32, MODE, DAZ, FTZ)                    \
+  DEFINE_BITMASK_HOOK(div, float, binary32, MODE, DAZ, FTZ)                    \
+  DEFINE_BITMASK_HOOK(add, double, binary64, MODE, DAZ, FTZ)                   \
+  DEFINE_BITMASK_HOOK(sub, double, binary64, MODE, DAZ, FTZ)                   \
+  DEFINE_BITMASK_HOOK(mul, double, binary64, MODE, DAZ, FTZ)                   \
+  DEFINE_BITMASK_HOOK(div, double, binary64, MODE, DAZ, FTZ)
+
+#define DEFINE_BITMASK_MODE_HOOKS(MODE)                                        \
+  DEFINE_BITMASK_HOOKS(MODE, 0, 0)                                             \
+  DEFINE_BITMASK_HOOKS(MODE, 0, 1)                                             \
+  DEFINE_BITMASK_HOOKS(MODE, 1, 0)                                             \
+  DEFINE_BITMASK_HOOKS(MODE, 1, 1)
+
+DEFINE_BITMASK_MODE_HOOKS(ieee)
+DEFINE_BITMASK_MODE_HOOKS(full)
+DEFINE_BITMASK_MODE_HOOKS(ib)
+DEFINE_BITMASK_MODE_HOOKS(ob)
+
+/* Interface of the hooks specialized for MODE, DAZ and FTZ */
+#define BITMASK_BACKEND(MODE, DAZ, FTZ)                                        \
+  {                                                                            \
+    _interflop_add_float_##MODE##_##DAZ##_##FTZ,                               \
+        _interflop_sub_float_##MODE##_##DAZ##_##FTZ,                           \
+        _interflop_mul_float_##MODE##_##DAZ##_##FTZ,                           \
+        _interflop_div_float_##MODE##_##DAZ##_##FTZ, NULL,                     \
+        _interflop_add_double_##MODE##_##DAZ##_##FTZ,                          \
+        _interflop_sub_double_##MODE##_##DAZ##_##FTZ,                          \
+        _interflop_mul_double_##MODE##_##DAZ##_##FTZ,                          \
+        _interflop_div_double_##MODE##_##DAZ##_##FTZ, NULL, NULL, NULL, NULL,  \
+        _interflop_add_float_vec_##MODE##_##DAZ##_##FTZ,                       \
+        _interflop_sub_float_vec_##MODE##_##DAZ##_##FTZ,                       \
+        _interflop_mul_float_vec_##MODE##_##DAZ##_##FTZ,                       \
+        _interflop_div_float_vec_##MODE##_##DAZ##_##FTZ,                       \
+        _interflop_add_double_vec_##MODE##_##DAZ##_##FTZ,                      \
+        _interflop_sub_double_vec_##MODE##_##DAZ##_##FTZ,                      \
+        _interflop_mul_double_vec_##MODE##_##DAZ##_##FTZ,                      \
+        _interflop_div_double_vec_##MODE##_##DAZ##_##FTZ                       \
+  }
 
-static void _interflop_mul_double(double a, double b, double *c,
-                                  void *context) {
-  *c = _bitmask_binary64_binary_op(a, b, bitmask_mul, context);
-}
+#define BITMASK_MODE_BACKENDS(MODE)                                            \
+  {                                                                            \
+    {BITMASK_BACKEND(MODE, 0, 0), BITMASK_BACKEND(MODE, 0, 1)},                \
+        {BITMASK_BACKEND(MODE, 1, 0), BITMASK_BACKEND(MODE, 1, 1)},            \
+  }
 
-static void _interflop_div_double(double a, double b, double *c,
-                                  void *context) {
-  *c = _bitmask_binary64_binary_op(a, b, bitmask_div, context);
-}
+/* Interfaces indexed by mode, daz and ftz */
+static const struct interflop_backend_interface_t
+    bitmask_backends[_bitmask_mode_end_][2][2] = {
+        [bitmask_mode_ieee] = BITMASK_MODE_BACKENDS(ieee),
+        [bitmask_mode_full] = BITMASK_MODE_BACKENDS(full),
+        [bitmask_mode_ib] = BITMASK_MODE_BACKENDS(ib),
+        [bitmask_mode_ob] = BITMASK_MODE_BACKENDS(ob)};
 
 static struct argp_option options[] = {
     {key_prec_b32_str, KEY_PREC_B32, "PRECISION", 0,
@@ -394,6 +440,8 @@ static struct argp_option options[] = {
     {key_operator_str, KEY_OPERATOR, "OPERATOR", 0,
      "select BITMASK operator among {zero, one, rand}", 0},
     {key_seed_str, KEY_SEED, "SEED", 0, "fix the random generator seed", 0},
+    {key_rng_str, KEY_RNG, "RNG", 0,
+     "select the random generator among {tinymt64, philox}", 0},
     {key_daz_str, KEY_DAZ, 0, 0,
      "denormals-are-zero: sets denormals inputs to zero", 0},
     {key_ftz_str, KEY_FTZ, 0, 0, "flush-to-zero: sets denormal output to zero",
@@ -474,6 +522,14 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
                    key_seed_str);
     }
     break;
+  case KEY_RNG:
+    /* random generator */
+    if (!_parse_rng_kind(arg, &ctx->rng_kind)) {
+      logger_error("--%s invalid value provided, must be one of: "
+                   "{tinymt64, philox}.",
+                   key_rng_str);
+    }
+    break;
   case KEY_DAZ:
     /* denormal-are-zero */
     ctx->daz = true;
@@ -493,6 +549,7 @@ static struct argp argp = {options, parse_opt, "", "", NULL, NULL, NULL};
 static void init_context(t_context *ctx) {
   ctx->choose_seed = false;
   ctx->seed = 0ULL;
+  ctx->rng_kind = rng_tinymt64;
   ctx->daz = false;
   ctx->ftz = false;
 }
@@ -535,23 +592,13 @@ struct interflop_backend_interface_t interflop_init(int argc, char **argv,
 
   print_information_header(ctx);
 
-  struct interflop_backend_interface_t interflop_backend_bitmask = {
-      _interflop_add_float,
-      _interflop_sub_float,
-      _interflop_mul_float,
-      _interflop_div_float,
-      NULL,
-      _interflop_add_double,
-      _interflop_sub_double,
-      _interflop_mul_double,
-      _interflop_div_double,
-      NULL,
-      NULL,
-      NULL,
-      NULL};
+  /* The hooks are specialized at compile time for each mode, daz and */
+  /* ftz combination, select the ones matching the options */
+  struct interflop_backend_interface_t interflop_backend_bitmask =
+      bitmask_backends[BITMASKLIB_MODE][ctx->daz][ctx->ftz];
 
   /* Initialize the seed */
-  _set_bitmask_seed(ctx->choose_seed, ctx->seed);
+  _set_bitmask_seed(ctx->rng_kind, ctx->choose_seed, ctx->seed);
 
   return interflop_backend_bitmask;
 }
@@ -51,6 +51,7 @@
 typedef struct {
   bool choose_seed;
   uint64_t seed;
+  rng_kind_t rng_kind;
 } t_context;
 
 /* define default environment variables and default parameters */
@@ -66,17 +67,24 @@ static void _set_tolerance(int tolerance) { TOLERANCE = tolerance; }
 
 static void _set_warning(bool warning) { WARN = warning; }
 
-/* random generator internal state */
-static tinymt64_t random_state;
+/* random generator internal state, one per thread */
+static __thread rng_state_t rng_state;
+
+/* random generator configuration shared by all the threads */
+static rng_config_t rng_config = {rng_tinymt64, false, 0};
 
 /* Set the mca seed */
-static void _set_mca_seed(const bool choose_seed, const uint64_t seed) {
-  _set_seed_default(&random_state, choose_seed, seed);
+static void _set_mca_seed(const rng_kind_t rng_kind, const bool choose_seed,
+                          const uint64_t seed) {
+  rng_config.kind = rng_kind;
+  rng_config.choose_seed = choose_seed;
+  rng_config.seed = seed;
+  _init_rng_state(&rng_state, &rng_config);
 }
 
 static double _mca_rand(void) {
   /* Returns a random double in the (0,1) open interval */
-  return tinymt64_generate_doubleOO(&random_state);
+  return _rng_generate_doubleOO(&rng_state, &rng_config);
 }
 
 /* noise = rand * 2^(exp) */
@@ -151,6 +159,8 @@ static struct argp_option options[] = {
     {"tolerance", 't', "TOLERANCE", 0, "Select tolerance (TOLERANCE >= 0)", 0},
     {"warning", 'w', "WARNING", 0, "Enable warning for cancellations", 0},
     {"seed", 's', "SEED", 0, "Fix the random generator seed", 0},
+    {"rng", 'r', "RNG", 0,
+     "Select the random generator among {tinymt64, philox}", 0},
     {0}};
 
 static error_t parse_opt(int key, char *arg, struct argp_state *state) {
@@ -179,6 +189,12 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
       logger_error("--seed invalid value provided, must be an integer");
     }
     break;
+  case 'r':
+    if (!_parse_rng_kind(arg, &ctx->rng_kind)) {
+      logger_error("--rng invalid value provided, must be one of: "
+                   "{tinymt64, philox}.");
+    }
+    break;
   default:
     return ARGP_ERR_UNKNOWN;
   }
@@ -190,6 +206,7 @@ static struct argp argp = {options, parse_opt, "", "", NULL, NULL, NULL};
 static void init_context(t_context *ctx) {
   ctx->choose_seed = 0;
   ctx->seed = 0ULL;
+  ctx->rng_kind = rng_tinymt64;
 }
 
 struct interflop_backend_interface_t interflop_init(int argc, char **argv,
@@ -222,10 +239,18 @@ struct interflop_backend_interface_t interflop_init(int argc, char **argv,
       NULL,
       NULL,
       NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
       NULL};
 
   /* Initialize the seed */
-  _set_mca_seed(ctx->choose_seed, ctx->seed);
+  _set_mca_seed(ctx->rng_kind, ctx->choose_seed, ctx->seed);
 
   return interflop_backend_cancellation;
 }
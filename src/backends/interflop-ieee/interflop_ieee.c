@@ -296,6 +296,74 @@ static void _interflop_cmp_double(const enum FCMP_PREDICATE p, const double a,
   debug_print_double(context, COMPARISON, str, a, b, *c);
 }
 
+static void _interflop_add_float_vec(int width, const float *a, const float *b,
+                                     float *c, void *context) {
+  for (int i = 0; i < width; i++) {
+    c[i] = a[i] + b[i];
+    debug_print_float(context, ARITHMETIC, "+", a[i], b[i], c[i]);
+  }
+}
+
+static void _interflop_sub_float_vec(int width, const float *a, const float *b,
+                                     float *c, void *context) {
+  for (int i = 0; i < width; i++) {
+    c[i] = a[i] - b[i];
+    debug_print_float(context, ARITHMETIC, "-", a[i], b[i], c[i]);
+  }
+}
+
+static void _interflop_mul_float_vec(int width, const float *a, const float *b,
+                                     float *c, void *context) {
+  for (int i = 0; i < width; i++) {
+    c[i] = a[i] * b[i];
+    debug_print_float(context, ARITHMETIC, "*", a[i], b[i], c[i]);
+  }
+}
+
+static void _interflop_div_float_vec(int width, const float *a, const float *b,
+                                     float *c, void *context) {
+  for (int i = 0; i < width; i++) {
+    c[i] = a[i] / b[i];
+    debug_print_float(context, ARITHMETIC, "/", a[i], b[i], c[i]);
+  }
+}
+
+static void _interflop_add_double_vec(int width, const double *a,
+                                      const double *b, double *c,
+                                      void *context) {
+  for (int i = 0; i < width; i++) {
+    c[i] = a[i] + b[i];
+    debug_print_double(context, ARITHMETIC, "+", a[i], b[i], c[i]);
+  }
+}
+
+static void _interflop_sub_double_vec(int width, const double *a,
+                                      const double *b, double *c,
+                                      void *context) {
+  for (int i = 0; i < width; i++) {
+    c[i] = a[i] - b[i];
+    debug_print_double(context, ARITHMETIC, "-", a[i], b[i], c[i]);
+  }
+}
+
+static void _interflop_mul_double_vec(int width, const double *a,
+                                      const double *b, double *c,
+                                      void *context) {
+  for (int i = 0; i < width; i++) {
+    c[i] = a[i] * b[i];
+    debug_print_double(context, ARITHMETIC, "*", a[i], b[i], c[i]);
+  }
+}
+
+static void _interflop_div_double_vec(int width, const double *a,
+                                      const double *b, double *c,
+                                      void *context) {
+  for (int i = 0; i < width; i++) {
+    c[i] = a[i] / b[i];
+    debug_print_double(context, ARITHMETIC, "/", a[i], b[i], c[i]);
+  }
+}
+
 static struct argp_option options[] = {
     {key_debug_str, KEY_DEBUG, 0, 0, "enable debug output", 0},
     {key_debug_binary_str, KEY_DEBUG_BINARY, 0, 0, "enable binary debug output",
@@ -371,7 +439,15 @@ struct interflop_backend_interface_t interflop_init(int argc, char **argv,
       _interflop_cmp_double,
       NULL,
       NULL,
-      NULL};
+      NULL,
+      _interflop_add_float_vec,
+      _interflop_sub_float_vec,
+      _interflop_mul_float_vec,
+      _interflop_div_float_vec,
+      _interflop_add_double_vec,
+      _interflop_sub_double_vec,
+      _interflop_mul_double_vec,
+      _interflop_div_double_vec};
 
   return interflop_backend_ieee;
 }
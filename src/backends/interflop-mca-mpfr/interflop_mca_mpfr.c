@@ -69,6 +69,7 @@
 typedef enum {
   KEY_PREC_B32,
   KEY_PREC_B64,
+  KEY_RNG,
   KEY_MODE = 'm',
   KEY_SEED = 's',
   KEY_DAZ = 'd',
@@ -79,12 +80,14 @@ static const char key_prec_b32_str[] = "precision-binary32";
 static const char key_prec_b64_str[] = "precision-binary64";
 static const char key_mode_str[] = "mode";
 static const char key_seed_str[] = "seed";
+static const char key_rng_str[] = "rng";
 static const char key_daz_str[] = "daz";
 static const char key_ftz_str[] = "ftz";
 
 typedef struct {
   bool choose_seed;
   uint64_t seed;
+  rng_kind_t rng_kind;
   bool daz;
   bool ftz;
 } t_context;
@@ -118,21 +121,13 @@ static int MCALIB_BINARY64_T = MCA_PRECISION_BINARY64_DEFAULT;
 #define GET_MCALIB_T(X)                                                        \
   _Generic((X), float : MCALIB_BINARY32_T, double : MCALIB_BINARY64_T)
 
-/* Generic macro that returns the MPFR precision used for computing depending on
- * the type of X */
-#define GET_MPFR_PREC(X) _Generic((X), float : DOUBLE_PREC, double : QUAD_PREC)
+/* Generic macro that sets the MPFR object M to X */
+#define MPFR_SET_FLT(M, X, RND)                                                \
+  _Generic((X), float : mpfr_set_flt(M, X, RND), double : mpfr_set_d(M, X, RND))
 
-/* Generic macro that returns the MPFR setter depending on the type of X  */
-#define MPFR_SET_FLT(X, RND)                                                   \
-  _Generic((X), float                                                          \
-           : mpfr_set_flt(mpfr_##X, X, RND), double                            \
-           : mpfr_set_d(mpfr_##X, X, RND))
-
-/* Generic macro that returns the MPFR getter depending on the type of X  */
-#define MPFR_GET_FLT(X, RND)                                                   \
-  _Generic((X), float                                                          \
-           : mpfr_get_flt(mpfr_##X, RND), double                               \
-           : mpfr_get_d(mpfr_##X, RND))
+/* Generic macro that returns the value of the MPFR object M in the type of X */
+#define MPFR_GET_FLT(M, X, RND)                                                \
+  _Generic((X), float : mpfr_get_flt(M, RND), double : mpfr_get_d(M, RND))
 
 #define MP_ADD &mpfr_add
 #define MP_SUB &mpfr_sub
@@ -181,49 +176,128 @@ static void _set_mca_precision_binary64(int precision) {
  * operands
  ***************************************************************/
 
-/* random generator internal state */
-static tinymt64_t random_state;
+/* random generator internal state, one per thread */
+static __thread rng_state_t rng_state;
 
-static double _mca_rand(void) {
-  /* Returns a random double in the (0,1) open interval */
-  return tinymt64_generate_doubleOO(&random_state);
+/* random generator configuration shared by all the threads */
+static rng_config_t rng_config = {rng_tinymt64, false, 0};
+
+static uint64_t _mca_rand_bits(void) {
+  /* Returns 64 random bits from the thread stream */
+  return _rng_generate_uint64(&rng_state, &rng_config);
 }
 
 /* Set the mca seed */
-static void _set_mca_seed(bool choose_seed, uint64_t seed) {
-  _set_seed_default(&random_state, choose_seed, seed);
+static void _set_mca_seed(const rng_kind_t rng_kind, const bool choose_seed,
+                          const uint64_t seed) {
+  rng_config.kind = rng_kind;
+  rng_config.choose_seed = choose_seed;
+  rng_config.seed = seed;
+  _init_rng_state(&rng_state, &rng_config);
 }
 
-/* Macro function that add mca noise to X */
-#define _MCA_INEXACT(X, rnd_mode)                                              \
-  do {                                                                         \
-    /* if we are in IEEE mode, we return a noise equal to 0 */                 \
-    /* if a is NaN, Inf or 0, we don't disturb it */                           \
-    if ((MCALIB_MODE_TYPE == mcamode_ieee) ||                                  \
-        (mpfr_regular_p(mpfr_##X) == 0)) {                                     \
-      break;                                                                   \
-    }                                                                          \
-    /* In RR, if the result is exact */                                        \
-    /* in the current virtual precision,*/                                     \
-    /* do not add  any noise  */                                               \
-    mpfr_prec_t min_prec = mpfr_min_prec(mpfr_##X);                            \
-    if (MCALIB_MODE_TYPE == mcamode_rr && min_prec <= GET_MCALIB_T(X)) {       \
-      break;                                                                   \
-    }                                                                          \
-    /* get_exp reproduce frexp behavior,  */                                   \
-    /* i.e. exp corresponding to a normalization */                            \
-    /* in the interval [1/2 1[ */                                              \
-    /* remove one to normalize in [1 2[ like ieee numbers */                   \
-    mpfr_exp_t e_a = mpfr_get_exp(mpfr_##X) - 1;                               \
-    mpfr_prec_t p_a = mpfr_get_prec(mpfr_##X);                                 \
-    MPFR_DECL_INIT(mpfr_rand, p_a);                                            \
-    e_a = e_a - (GET_MCALIB_T(X) - 1);                                         \
-    double d_rand = (_mca_rand() - 0.5);                                       \
-    mpfr_set_d(mpfr_rand, d_rand, rnd_mode);                                   \
-    /* rand = rand * 2 ^ (e_a) */                                              \
-    mpfr_mul_2si(mpfr_rand, mpfr_rand, e_a, rnd_mode);                         \
-    mpfr_add(mpfr_##X, mpfr_##X, mpfr_rand, rnd_mode);                         \
-  } while (0)
+/* Adds the mca noise to x at the virtual precision t */
+/* noise is a scratch object with the same precision as x */
+static void _mca_inexact(mpfr_ptr x, mpfr_ptr noise, const int t,
+                         const mpfr_rnd_t rnd_mode) {
+  /* if we are in IEEE mode, we return a noise equal to 0 */
+  /* if a is NaN, Inf or 0, we don't disturb it */
+  if ((MCALIB_MODE_TYPE == mcamode_ieee) || (mpfr_regular_p(x) == 0)) {
+    return;
+  }
+  /* In RR, if the result is exact */
+  /* in the current virtual precision,*/
+  /* do not add  any noise  */
+  if (MCALIB_MODE_TYPE == mcamode_rr && mpfr_min_prec(x) <= t) {
+    return;
+  }
+  /* get_exp reproduce frexp behavior,  */
+  /* i.e. exp corresponding to a normalization */
+  /* in the interval [1/2 1[ */
+  /* remove one to normalize in [1 2[ like ieee numbers */
+  mpfr_exp_t e_a = mpfr_get_exp(x) - 1;
+  e_a = e_a - (t - 1);
+  /* The noise u - 0.5 with u in (0,1) is k * 2^-52, it is set exactly */
+  /* from the integer k without going through a double. */
+  const int64_t k = _noise_integer(_mca_rand_bits());
+  mpfr_set_si_2exp(noise, k, e_a - DOUBLE_PMAN_SIZE, rnd_mode);
+  mpfr_add(x, x, noise, rnd_mode);
+}
+
+/* Largest precision of binary64 operations */
+#define MPFR_PREC_BINARY64_MAX (MCA_PRECISION_BINARY64_MAX + 64)
+
+/* Returns the precision of binary64 operations: QUAD_PREC up to a */
+/* virtual precision of 112 and the smallest multiple of 64 bits above */
+/* the virtual precision otherwise, like the fixed-limb path of the MCA */
+/* backend */
+static mpfr_prec_t _mpfr_prec_binary64(void) {
+  if (MCALIB_BINARY64_T < QUAD_PREC) {
+    return QUAD_PREC;
+  } else if (MCALIB_BINARY64_T > MCA_PRECISION_BINARY64_MAX) {
+    return MPFR_PREC_BINARY64_MAX;
+  }
+  return (MCALIB_BINARY64_T / 64 + 1) * 64;
+}
+
+/* Scratch MPFR objects reused by every operation of a thread */
+typedef struct {
+  mpfr_t x;
+  mpfr_t y;
+  mpfr_t noise;
+} mpfr_operands_t;
+
+#define MPFR_LIMBS(PREC) (((PREC)-1) / GMP_NUMB_BITS + 1)
+
+/* Operands of binary32 operations computed at precision DOUBLE_PREC */
+static __thread mpfr_operands_t mpfr_operands_binary32;
+static __thread mp_limb_t mpfr_limbs_binary32[3][MPFR_LIMBS(DOUBLE_PREC)];
+static __thread bool mpfr_operands_binary32_init = false;
+
+/* Operands of binary64 operations computed at precision */
+/* _mpfr_prec_binary64() */
+static __thread mpfr_operands_t mpfr_operands_binary64;
+static __thread mp_limb_t
+    mpfr_limbs_binary64[3][MPFR_LIMBS(MPFR_PREC_BINARY64_MAX)];
+static __thread bool mpfr_operands_binary64_init = false;
+
+/* Binds the operands to the thread-local limbs at precision prec */
+/* The significands live in TLS so there is nothing to free at thread exit */
+static void _init_mpfr_operands(mpfr_operands_t *ops, mp_limb_t *limbs,
+                                const size_t nlimbs, const mpfr_prec_t prec) {
+  mpfr_custom_init(limbs, prec);
+  mpfr_custom_init_set(ops->x, MPFR_ZERO_KIND, 0, prec, limbs);
+  mpfr_custom_init(limbs + nlimbs, prec);
+  mpfr_custom_init_set(ops->y, MPFR_ZERO_KIND, 0, prec, limbs + nlimbs);
+  mpfr_custom_init(limbs + 2 * nlimbs, prec);
+  mpfr_custom_init_set(ops->noise, MPFR_ZERO_KIND, 0, prec,
+                       limbs + 2 * nlimbs);
+}
+
+static mpfr_operands_t *_get_mpfr_operands_binary32(void) {
+  if (!mpfr_operands_binary32_init) {
+    _init_mpfr_operands(&mpfr_operands_binary32, mpfr_limbs_binary32[0],
+                        MPFR_LIMBS(DOUBLE_PREC), DOUBLE_PREC);
+    mpfr_operands_binary32_init = true;
+  }
+  return &mpfr_operands_binary32;
+}
+
+static mpfr_operands_t *_get_mpfr_operands_binary64(void) {
+  if (!mpfr_operands_binary64_init) {
+    _init_mpfr_operands(&mpfr_operands_binary64, mpfr_limbs_binary64[0],
+                        MPFR_LIMBS(MPFR_PREC_BINARY64_MAX),
+                        _mpfr_prec_binary64());
+    mpfr_operands_binary64_init = true;
+  }
+  return &mpfr_operands_binary64;
+}
+
+/* Generic macro that returns the scratch operands for the type of X */
+#define GET_MPFR_OPERANDS(X)                                                   \
+  _Generic((X), float                                                          \
+           : _get_mpfr_operands_binary32(), double                             \
+           : _get_mpfr_operands_binary64())
 
 /******************** MCA ARITHMETIC FUNCTIONS ********************
  * The following set of functions perform the MCA operation. Operands
@@ -235,25 +309,24 @@ static void _set_mca_seed(bool choose_seed, uint64_t seed) {
 /* Generic macro function that returns mca(X OP Y) */
 #define _MCA_BINARY_OP(X, Y, OP, CTX)                                          \
   {                                                                            \
-    mpfr_prec_t prec = GET_MPFR_PREC(X);                                       \
+    mpfr_operands_t *ops = GET_MPFR_OPERANDS(X);                               \
+    const int t = GET_MCALIB_T(X);                                             \
     mpfr_rnd_t rnd = MPFR_RNDN;                                                \
     if (((t_context *)CTX)->daz) {                                             \
       X = DAZ(X);                                                              \
       Y = DAZ(Y);                                                              \
     }                                                                          \
-    MPFR_DECL_INIT(mpfr_##X, prec);                                            \
-    MPFR_DECL_INIT(mpfr_##Y, prec);                                            \
-    MPFR_SET_FLT(X, rnd);                                                      \
-    MPFR_SET_FLT(Y, rnd);                                                      \
+    MPFR_SET_FLT(ops->x, X, rnd);                                              \
+    MPFR_SET_FLT(ops->y, Y, rnd);                                              \
     if (MCALIB_MODE_TYPE != mcamode_rr) {                                      \
-      _MCA_INEXACT(X, rnd);                                                    \
-      _MCA_INEXACT(Y, rnd);                                                    \
+      _mca_inexact(ops->x, ops->noise, t, rnd);                                \
+      _mca_inexact(ops->y, ops->noise, t, rnd);                                \
     }                                                                          \
-    mpfr_op(mpfr_##X, mpfr_##X, mpfr_##Y, rnd);                                \
+    OP(ops->x, ops->x, ops->y, rnd);                                           \
     if (MCALIB_MODE_TYPE != mcamode_pb) {                                      \
-      _MCA_INEXACT(X, rnd);                                                    \
+      _mca_inexact(ops->x, ops->noise, t, rnd);                                \
     }                                                                          \
-    typeof(X) ret = MPFR_GET_FLT(X, rnd);                                      \
+    typeof(X) ret = MPFR_GET_FLT(ops->x, X, rnd);                              \
     if (((t_context *)CTX)->ftz) {                                             \
       ret = FTZ(ret);                                                          \
     }                                                                          \
@@ -263,21 +336,21 @@ static void _set_mca_seed(bool choose_seed, uint64_t seed) {
 /* Generic macro function that returns mca(OP X) */
 #define _MCA_UNARY_OP(X, OP, CTX)                                              \
   {                                                                            \
-    mpfr_prec_t prec = GET_MPFR_PREC(X);                                       \
+    mpfr_operands_t *ops = GET_MPFR_OPERANDS(X);                               \
+    const int t = GET_MCALIB_T(X);                                             \
     mpfr_rnd_t rnd = MPFR_RNDN;                                                \
     if (((t_context *)CTX)->daz) {                                             \
       X = DAZ(X);                                                              \
     }                                                                          \
-    MPFR_DECL_INIT(mpfr_##X, prec);                                            \
-    MPFR_SET_FLT(X, rnd);                                                      \
+    MPFR_SET_FLT(ops->x, X, rnd);                                              \
     if (MCALIB_MODE_TYPE != mcamode_rr) {                                      \
-      _MCA_INEXACT(X, rnd);                                                    \
+      _mca_inexact(ops->x, ops->noise, t, rnd);                                \
     }                                                                          \
-    mpfr_op(mpfr_a, mpfr_a, rnd);                                              \
+    OP(ops->x, ops->x, rnd);                                                   \
     if (MCALIB_MODE_TYPE != mcamode_pb) {                                      \
-      _MCA_INEXACT(X, rnd);                                                    \
+      _mca_inexact(ops->x, ops->noise, t, rnd);                                \
     }                                                                          \
-    typeof(X) ret = MPFR_GET_FLT(X, rnd);                                      \
+    typeof(X) ret = MPFR_GET_FLT(ops->x, X, rnd);                              \
     if (((t_context *)CTX)->ftz) {                                             \
       ret = FTZ(ret);                                                          \
     }                                                                          \
@@ -297,15 +370,17 @@ static float _mca_binary32_unary_op(float a, mpfr_unr mpfr_op, void *context) {
   _MCA_UNARY_OP(a, mpfr_op, context);
 }
 
-/* Performs mca(a mpfr_op b) where a and b are binary32 values */
-/* Intermediate computations are performed with precision QUAD_PREC */
+/* Performs mca(a mpfr_op b) where a and b are binary64 values */
+/* Intermediate computations are performed with precision */
+/* _mpfr_prec_binary64() */
 static double _mca_binary64_binary_op(double a, double b, mpfr_bin mpfr_op,
                                       void *context) {
   _MCA_BINARY_OP(a, b, mpfr_op, context);
 }
 
-/* Performs mca(mpfr_op a) where a is a binary32 value */
-/* Intermediate computations are performed with precision QUAD_PREC */
+/* Performs mca(mpfr_op a) where a is a binary64 value */
+/* Intermediate computations are performed with precision */
+/* _mpfr_prec_binary64() */
 static double _mca_binary64_unary_op(double a, mpfr_unr mpfr_op,
                                      void *context) {
   _MCA_UNARY_OP(a, mpfr_op, context);
@@ -361,6 +436,8 @@ static struct argp_option options[] = {
     {key_mode_str, KEY_MODE, "MODE", 0,
      "select MCA mode among {ieee, mca, pb, rr}", 0},
     {key_seed_str, KEY_SEED, "SEED", 0, "fix the random generator seed", 0},
+    {key_rng_str, KEY_RNG, "RNG", 0,
+     "select the random generator among {tinymt64, philox}", 0},
     {key_daz_str, KEY_DAZ, 0, 0,
      "denormals-are-zero: sets denormals inputs to zero", 0},
     {key_ftz_str, KEY_FTZ, 0, 0, "flush-to-zero: sets denormal output to zero",
@@ -420,6 +497,14 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
                    key_seed_str);
     }
     break;
+  case KEY_RNG:
+    /* random generator */
+    if (!_parse_rng_kind(arg, &ctx->rng_kind)) {
+      logger_error("--%s invalid value provided, must be one of: "
+                   "{tinymt64, philox}.",
+                   key_rng_str);
+    }
+    break;
   case KEY_DAZ:
     /* denormal-are-zero */
     ctx->daz = true;
@@ -439,6 +524,9 @@ static struct argp argp = {options, parse_opt, "", "", NULL, NULL, NULL};
 static void init_context(t_context *ctx) {
   ctx->choose_seed = false;
   ctx->seed = 0ULL;
+  ctx->rng_kind = rng_tinymt64;
+  ctx->daz = false;
+  ctx->ftz = false;
 }
 
 /* Displays arguments when the backend is loaded */
@@ -490,10 +578,18 @@ struct interflop_backend_interface_t interflop_init(int argc, char **argv,
       NULL,
       NULL,
       NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
       NULL};
 
   /* Initialize the seed */
-  _set_mca_seed(ctx->choose_seed, ctx->seed);
+  _set_mca_seed(ctx->rng_kind, ctx->choose_seed, ctx->seed);
 
   return interflop_backend_mca;
 }
@@ -64,6 +64,7 @@
 #include <sys/time.h>
 #include <unistd.h>
 
+#include "../../common/fixed_mp.h"
 #include "../../common/float_const.h"
 #include "../../common/float_struct.h"
 #include "../../common/float_utils.h"
@@ -75,6 +76,8 @@
 typedef enum {
   KEY_PREC_B32,
   KEY_PREC_B64,
+  KEY_RNG,
+  KEY_BINARY64_QUAD,
   KEY_MODE = 'm',
   KEY_SEED = 's',
   KEY_DAZ = 'd',
@@ -85,14 +88,18 @@ static const char key_prec_b32_str[] = "precision-binary32";
 static const char key_prec_b64_str[] = "precision-binary64";
 static const char key_mode_str[] = "mode";
 static const char key_seed_str[] = "seed";
+static const char key_rng_str[] = "rng";
 static const char key_daz_str[] = "daz";
 static const char key_ftz_str[] = "ftz";
+static const char key_binary64_quad_str[] = "binary64-quad";
 
 typedef struct {
   bool choose_seed;
   uint64_t seed;
+  rng_kind_t rng_kind;
   bool daz;
   bool ftz;
+  bool binary64_quad;
 } t_context;
 
 /* define the available MCA modes of operation */
@@ -110,7 +117,7 @@ static const char *MCA_MODE_STR[] = {"ieee", "mca", "pb", "rr"};
 #define MCA_PRECISION_BINARY32_MIN 1
 #define MCA_PRECISION_BINARY64_MIN 1
 #define MCA_PRECISION_BINARY32_MAX 53
-#define MCA_PRECISION_BINARY64_MAX 112
+#define MCA_PRECISION_BINARY64_MAX 255
 #define MCA_PRECISION_BINARY32_DEFAULT 24
 #define MCA_PRECISION_BINARY64_DEFAULT 53
 #define MCA_MODE_DEFAULT mcamode_mca
@@ -118,6 +125,8 @@ static const char *MCA_MODE_STR[] = {"ieee", "mca", "pb", "rr"};
 static mcamode MCALIB_MODE = MCA_MODE_DEFAULT;
 static int MCALIB_BINARY32_T = MCA_PRECISION_BINARY32_DEFAULT;
 static int MCALIB_BINARY64_T = MCA_PRECISION_BINARY64_DEFAULT;
+/* number of fixed_mp limbs used above the binary128 precision */
+static int MCALIB_BINARY64_LIMBS = 2;
 
 /* possible operations values */
 typedef enum {
@@ -127,11 +136,6 @@ typedef enum {
   mca_div = '/'
 } mca_operations;
 
-static float _mca_binary32_binary_op(float a, float b, const mca_operations op,
-                                     void *context);
-static double _mca_binary64_binary_op(double a, double b,
-                                      const mca_operations op, void *context);
-
 /******************** MCA CONTROL FUNCTIONS *******************
  * The following functions are used to set virtual precision and
  * MCA mode of operation.
@@ -155,6 +159,13 @@ static void _set_mca_precision_binary32(const int precision) {
 /* Set the virtual precision for binary64 */
 static void _set_mca_precision_binary64(const int precision) {
   _set_precision(MCA, precision, &MCALIB_BINARY64_T, (double)0);
+  /* smallest multiple of 64 bits above the virtual precision */
+  MCALIB_BINARY64_LIMBS = MCALIB_BINARY64_T / 64 + 1;
+  if (MCALIB_BINARY64_LIMBS < 2) {
+    MCALIB_BINARY64_LIMBS = 2;
+  } else if (MCALIB_BINARY64_LIMBS > FMP_LIMBS_MAX) {
+    MCALIB_BINARY64_LIMBS = FMP_LIMBS_MAX;
+  }
 }
 
 /******************** MCA RANDOM FUNCTIONS ********************
@@ -162,46 +173,48 @@ static void _set_mca_precision_binary64(const int precision) {
  * perturbations used for MCA
  ***************************************************************/
 
-/* random generator internal state */
-static tinymt64_t random_state;
+/* random generator internal state, one per thread */
+static __thread rng_state_t rng_state;
+
+/* random generator configuration shared by all the threads */
+static rng_config_t rng_config = {rng_tinymt64, false, 0};
 
-static double _mca_rand(void) {
-  /* Returns a random double in the (0,1) open interval */
-  return tinymt64_generate_doubleOO(&random_state);
+static uint64_t _mca_rand_bits(void) {
+  /* Returns 64 random bits */
+  return _rng_generate_uint64(&rng_state, &rng_config);
 }
 
-/* noise = rand * 2^(exp) */
+/* noise = (rand - 0.5) * 2^(exp) */
 /* We can skip special cases since we never met them */
 /* Since we have exponent of float values, the result */
 /* is comprised between: */
 /* 127+127 = 254 < DOUBLE_EXP_MAX (1023)  */
 /* -126-24+-126-24 = -300 > DOUBLE_EXP_MIN (-1022) */
+/* The noise is built from the random bits with integer operations */
 static inline double _noise_binary64(const int exp) {
-  const double d_rand = (_mca_rand() - 0.5);
-  return _fast_pow2_binary64(exp) * d_rand;
+  return _noise_from_bits_binary64(_mca_rand_bits(), exp);
 }
 
-/* noise = rand * 2^(exp) */
+/* noise = (rand - 0.5) * 2^(exp) */
 /* We can skip special cases since we never met them */
 /* Since we have exponent of double values, the result */
 /* is comprised between: */
 /* 1023+1023 = 2046 < QUAD_EXP_MAX (16383)  */
 /* -1022-53+-1022-53 = -2200 > QUAD_EXP_MIN (-16382) */
-static __float128 _noise_binary128(const int exp) {
-  /* random number in (-0.5, 0.5) */
-  const __float128 noise = (__float128)_mca_rand() - 0.5Q;
-  return _fast_pow2_binary128(exp) * noise;
+/* The noise is built from the random bits with integer operations */
+static inline __float128 _noise_binary128(const int exp) {
+  return _noise_from_bits_binary128(_mca_rand_bits(), exp);
 }
 
 /* Macro function for checking if the value X must be noised */
-#define _MUST_NOT_BE_NOISED(X, VIRTUAL_PRECISION)                              \
+#define _MUST_NOT_BE_NOISED(X, VIRTUAL_PRECISION, MODE)                        \
   /* if mode ieee, do not introduce noise */                                   \
-  (MCALIB_MODE == mcamode_ieee) ||					\
-  /* Check that we are not in a special case */				\
-  (FPCLASSIFY(X) != FP_NORMAL && FPCLASSIFY(X) != FP_SUBNORMAL) ||	\
-  /* In RR if the number is representable in current virtual precision, */ \
-  /* do not add any noise if */						\
-  (MCALIB_MODE == mcamode_rr && _IS_REPRESENTABLE(X, VIRTUAL_PRECISION))
+  (MODE == mcamode_ieee) ||                                                    \
+  /* Check that we are not in a special case */                                \
+  (FPCLASSIFY(X) != FP_NORMAL && FPCLASSIFY(X) != FP_SUBNORMAL) ||             \
+  /* In RR if the number is representable in current virtual precision, */     \
+  /* do not add any noise if */                                                \
+  (MODE == mcamode_rr && _IS_REPRESENTABLE(X, VIRTUAL_PRECISION))
 
 /* Generic function for computing the mca noise */
 #define _NOISE(X, EXP)                                                         \
@@ -209,9 +222,9 @@ static __float128 _noise_binary128(const int exp) {
 
 /* Macro function that adds mca noise to X
    according to the virtual_precision VIRTUAL_PRECISION */
-#define _INEXACT(X, VIRTUAL_PRECISION)                                         \
+#define _INEXACT(X, VIRTUAL_PRECISION, MODE)                                   \
   {                                                                            \
-    if (_MUST_NOT_BE_NOISED(*X, VIRTUAL_PRECISION)) {                          \
+    if (_MUST_NOT_BE_NOISED(*X, VIRTUAL_PRECISION, MODE)) {                    \
       return;                                                                  \
     } else {                                                                   \
       const int32_t e_a = GET_EXP_FLT(*X);                                     \
@@ -222,25 +235,31 @@ static __float128 _noise_binary128(const int exp) {
   }
 
 /* Adds the mca noise to da */
-static void _mca_inexact_binary64(double *da) {
-  _INEXACT(da, MCALIB_BINARY32_T);
+static __attribute__((always_inline)) inline void
+_mca_inexact_binary64(double *da, const mcamode mode) {
+  _INEXACT(da, MCALIB_BINARY32_T, mode);
 }
 
 /* Adds the mca noise to qa */
-static void _mca_inexact_binary128(__float128 *qa) {
-  _INEXACT(qa, MCALIB_BINARY64_T);
+static __attribute__((always_inline)) inline void
+_mca_inexact_binary128(__float128 *qa, const mcamode mode) {
+  _INEXACT(qa, MCALIB_BINARY64_T, mode);
 }
 
 /* Generic functions that adds noise to A */
 /* The function is choosen depending on the type of X  */
-#define _INEXACT_BINARYN(X, A)                                                 \
+#define _INEXACT_BINARYN(X, A, MODE)                                           \
   _Generic(X, double                                                           \
            : _mca_inexact_binary64, __float128                                 \
-           : _mca_inexact_binary128)(A)
+           : _mca_inexact_binary128)(A, MODE)
 
 /* Set the mca seed */
-static void _set_mca_seed(const bool choose_seed, const uint64_t seed) {
-  _set_seed_default(&random_state, choose_seed, seed);
+static void _set_mca_seed(const rng_kind_t rng_kind, const bool choose_seed,
+                          const uint64_t seed) {
+  rng_config.kind = rng_kind;
+  rng_config.choose_seed = choose_seed;
+  rng_config.seed = seed;
+  _init_rng_state(&rng_state, &rng_config);
 }
 
 /******************** MCA ARITHMETIC FUNCTIONS ********************
@@ -272,85 +291,394 @@ static void _set_mca_seed(const bool choose_seed, const uint64_t seed) {
 
 /* Generic macro function that returns mca(A OP B) */
 /* Functions are determined according to the type of X */
-#define _MCA_BINARY_OP(A, B, OP, CTX, X)                                       \
+/* MODE, DAZ and FTZ are compile-time constants in the specialized hooks */
+#define _MCA_BINARY_OP(A, B, OP, MODE, IS_DAZ, IS_FTZ, X)                      \
   do {                                                                         \
     typeof(X) _A = A;                                                          \
     typeof(X) _B = B;                                                          \
     typeof(X) _RES = 0;                                                        \
-    if (((t_context *)CTX)->daz) {                                             \
+    if (IS_DAZ) {                                                              \
       _A = DAZ(A);                                                             \
       _B = DAZ(B);                                                             \
     }                                                                          \
-    if (MCALIB_MODE == mcamode_pb || MCALIB_MODE == mcamode_mca) {             \
-      _INEXACT_BINARYN(X, &_A);                                                \
-      _INEXACT_BINARYN(X, &_B);                                                \
+    if (MODE == mcamode_pb || MODE == mcamode_mca) {                           \
+      _INEXACT_BINARYN(X, &_A, MODE);                                          \
+      _INEXACT_BINARYN(X, &_B, MODE);                                          \
     }                                                                          \
     PERFORM_BIN_OP(OP, _RES, _A, _B);                                          \
-    if (MCALIB_MODE == mcamode_rr || MCALIB_MODE == mcamode_mca) {             \
-      _INEXACT_BINARYN(X, &_RES);                                              \
+    if (MODE == mcamode_rr || MODE == mcamode_mca) {                           \
+      _INEXACT_BINARYN(X, &_RES, MODE);                                        \
     }                                                                          \
-    if (((t_context *)CTX)->ftz) {                                             \
+    if (IS_FTZ) {                                                              \
       _RES = FTZ((typeof(A))_RES);                                             \
     }                                                                          \
     return (typeof(A))(_RES);                                                  \
   } while (0);
 
-/* Performs mca(a dop b) where a and b are binary32 values */
-/* Intermediate computations are performed with binary64 */
-inline float _mca_binary32_binary_op(const float a, const float b,
-                                     const mca_operations dop, void *context) {
-  _MCA_BINARY_OP(a, b, dop, context, (double)0);
+/******************** MCA DOUBLE-DOUBLE FUNCTIONS ********************
+ * binary64 operations are computed with double-double arithmetic,
+ * built on the TwoSum and TwoProd error-free transformations, when the
+ * virtual precision is at most 53 and the operands are far enough from
+ * overflow and underflow. Otherwise the binary128 path is used.
+ * _dd_mul drops a.lo * b.lo and _dd_div computes three quotient digits,
+ * so intermediates are within about 2^-104, relative, of the binary128
+ * ones and results only differ from the binary128 path in rare final
+ * roundings.
+ **********************************************************************/
+
+/* Nonzero operands must have an exponent in [-MCA_DD_EXP_MAX, */
+/* MCA_DD_EXP_MAX] so that results, error terms and noises neither */
+/* overflow nor become subnormal */
+#define MCA_DD_EXP_MAX 450
+
+static inline double_double _dd_neg(const double_double a) {
+  return (double_double){-a.hi, -a.lo};
 }
 
-/* Performs mca(a qop b) where a and b are binary64 values */
-/* Intermediate computations are performed with binary128 */
-inline double _mca_binary64_binary_op(const double a, const double b,
-                                      const mca_operations qop, void *context) {
-  _MCA_BINARY_OP(a, b, qop, context, (__float128)0);
+static inline double_double _dd_add_d(const double_double a, const double b) {
+  const double_double s = _dd_two_sum(a.hi, b);
+  return _dd_fast_two_sum(s.hi, s.lo + a.lo);
 }
 
-/************************* FPHOOKS FUNCTIONS *************************
- * These functions correspond to those inserted into the source code
- * during source to source compilation and are replacement to floating
- * point operators
- **********************************************************************/
+static inline double_double _dd_add(const double_double a,
+                                    const double_double b) {
+  const double_double s = _dd_two_sum(a.hi, b.hi);
+  const double_double t = _dd_two_sum(a.lo, b.lo);
+  const double_double u = _dd_fast_two_sum(s.hi, s.lo + t.hi);
+  return _dd_fast_two_sum(u.hi, u.lo + t.lo);
+}
 
-static void _interflop_add_float(float a, float b, float *c, void *context) {
-  *c = _mca_binary32_binary_op(a, b, mca_add, context);
+static inline double_double _dd_mul_d(const double_double a, const double b) {
+  const double_double p = _dd_two_prod(a.hi, b);
+  return _dd_fast_two_sum(p.hi, p.lo + a.lo * b);
 }
 
-static void _interflop_sub_float(float a, float b, float *c, void *context) {
-  *c = _mca_binary32_binary_op(a, b, mca_sub, context);
+static inline double_double _dd_mul(const double_double a,
+                                    const double_double b) {
+  const double_double p = _dd_two_prod(a.hi, b.hi);
+  return _dd_fast_two_sum(p.hi, p.lo + (a.hi * b.lo + a.lo * b.hi));
 }
 
-static void _interflop_mul_float(float a, float b, float *c, void *context) {
-  *c = _mca_binary32_binary_op(a, b, mca_mul, context);
+/* Long division: three quotient digits, two remainder corrections */
+static inline double_double _dd_div(const double_double a,
+                                    const double_double b) {
+  const double q1 = a.hi / b.hi;
+  double_double r = _dd_add(a, _dd_neg(_dd_mul_d(b, q1)));
+  const double q2 = r.hi / b.hi;
+  r = _dd_add(r, _dd_neg(_dd_mul_d(b, q2)));
+  const double q3 = r.hi / b.hi;
+  return _dd_add_d(_dd_fast_two_sum(q1, q2), q3);
 }
 
-static void _interflop_div_float(float a, float b, float *c, void *context) {
-  *c = _mca_binary32_binary_op(a, b, mca_div, context);
+/* Returns the exponent of the exact value x.hi + x.lo, which is one less */
+/* than the exponent of x.hi when x.hi was rounded up to a power of two */
+static inline int32_t _dd_get_exponent(const double_double x) {
+  const binary64 b64 = {.f64 = x.hi};
+  const int32_t e = b64.ieee.exponent - DOUBLE_EXP_COMP;
+  const bool below = (x.lo != 0) && ((x.lo < 0) != (x.hi < 0));
+  return (b64.ieee.mantissa == 0 && below) ? e - 1 : e;
 }
 
-static void _interflop_add_double(double a, double b, double *c,
-                                  void *context) {
-  *c = _mca_binary64_binary_op(a, b, mca_add, context);
+/* Drops x.lo when x rounded to binary128 is x.hi, that is when x.lo is */
+/* at most half an ulp of binary128 (ties go to x.hi whose 113th bit is */
+/* zero). Results are then noised as the binary128 path does. */
+static inline void _dd_round_binary128(double_double *x) {
+  const bool below = (x->lo < 0) != (x->hi < 0);
+  const binary64 b64 = {.f64 = x->hi};
+  const int32_t e = b64.ieee.exponent - DOUBLE_EXP_COMP;
+  const int32_t e_half_ulp =
+      e - QUAD_PMAN_SIZE - ((b64.ieee.mantissa == 0 && below) ? 2 : 1);
+  if (fabs(x->lo) <= _fast_pow2_binary64(e_half_ulp)) {
+    x->lo = 0;
+  }
+}
+
+/* Adds the mca noise to the double-double x, as _mca_inexact_binary128 */
+/* does for binary128 values */
+static __attribute__((always_inline)) inline void
+_mca_inexact_dd(double_double *x, const mcamode mode) {
+  if (x->hi == 0) {
+    return;
+  }
+  /* x is representable iff its lower part is zero */
+  if (mode == mcamode_rr && x->lo == 0 &&
+      _is_representable_binary64(x->hi, MCALIB_BINARY64_T)) {
+    return;
+  }
+  const int32_t e_n = _dd_get_exponent(*x) - (MCALIB_BINARY64_T - 1);
+  *x = _dd_add_d(*x, _noise_binary64(e_n));
 }
 
-static void _interflop_sub_double(double a, double b, double *c,
-                                  void *context) {
-  *c = _mca_binary64_binary_op(a, b, mca_sub, context);
+/* Returns true if the double-double path can compute a qop b */
+static inline bool _mca_dd_is_valid(const double a, const double b,
+                                    const mca_operations qop) {
+  const int32_t e_a = GET_EXP_FLT(a);
+  const int32_t e_b = GET_EXP_FLT(b);
+  const bool a_valid =
+      (a == 0) || (-MCA_DD_EXP_MAX <= e_a && e_a <= MCA_DD_EXP_MAX);
+  const bool b_valid = (b == 0 && qop != mca_div) ||
+                       (-MCA_DD_EXP_MAX <= e_b && e_b <= MCA_DD_EXP_MAX);
+  if (!a_valid || !b_valid) {
+    return false;
+  }
+  /* When the exponents of a sum are too far apart, the smaller operand */
+  /* only breaks rounding ties. binary128 keeps it while double-double */
+  /* may not, so those sums use binary128. */
+  if ((qop == mca_add || qop == mca_sub) && a != 0 && b != 0) {
+    return abs(e_a - e_b) <= DOUBLE_PREC;
+  }
+  return true;
 }
 
-static void _interflop_mul_double(double a, double b, double *c,
-                                  void *context) {
-  *c = _mca_binary64_binary_op(a, b, mca_mul, context);
+/* Performs mca(a qop b) with double-double intermediates */
+static __attribute__((always_inline)) inline double
+_mca_binary64_binary_op_dd(const double a, const double b,
+                           const mca_operations qop, const mcamode mode) {
+  double_double _A = {a, 0};
+  double_double _B = {b, 0};
+  double_double _RES = {0, 0};
+  if (mode == mcamode_pb || mode == mcamode_mca) {
+    _mca_inexact_dd(&_A, mode);
+    _mca_inexact_dd(&_B, mode);
+  }
+  switch (qop) {
+  case mca_add:
+    _RES = _dd_add(_A, _B);
+    break;
+  case mca_sub:
+    _RES = _dd_add(_A, _dd_neg(_B));
+    break;
+  case mca_mul:
+    _RES = _dd_mul(_A, _B);
+    break;
+  case mca_div:
+    _RES = _dd_div(_A, _B);
+    break;
+  default:
+    logger_error("invalid operator %c", qop);
+  }
+  /* Exact zero results take the sign given by the IEEE operation */
+  if (_RES.hi == 0) {
+    PERFORM_BIN_OP(qop, _RES.hi, _A.hi, _B.hi);
+  } else {
+    _dd_round_binary128(&_RES);
+  }
+  if (mode == mcamode_rr || mode == mcamode_mca) {
+    _mca_inexact_dd(&_RES, mode);
+  }
+  /* _RES.hi is _RES.hi + _RES.lo rounded to nearest */
+  return _RES.hi;
 }
 
-static void _interflop_div_double(double a, double b, double *c,
-                                  void *context) {
-  *c = _mca_binary64_binary_op(a, b, mca_div, context);
+/******************** MCA FIXED-LIMB FUNCTIONS ********************
+ * binary64 operations with a virtual precision of at least 113 bits do
+ * not fit in binary128. They are computed with the fixed_mp numbers of
+ * fixed_mp.h on 2, 3 or 4 limbs, the smallest multiple of 64 bits above
+ * the virtual precision. The MCA-MPFR backend uses the same working
+ * precision so that both backends give the same results.
+ ********************************************************************/
+
+/* Adds the mca noise to x, as _mca_inexact_binary128 does for binary128 */
+/* values */
+static __attribute__((always_inline)) inline void
+_mca_inexact_fmp(fixed_mp *x, const mcamode mode, const int n) {
+  if (_fmp_is_zero(x, n)) {
+    return;
+  }
+  if (mode == mcamode_rr && _fmp_min_prec(x, n) <= MCALIB_BINARY64_T) {
+    return;
+  }
+  const int32_t e_n = x->exp - (MCALIB_BINARY64_T - 1);
+  fixed_mp noise;
+  _fmp_set_si_2exp(&noise, _noise_integer(_mca_rand_bits()),
+                   e_n - DOUBLE_PMAN_SIZE, n);
+  _fmp_add(x, x, &noise, n);
 }
 
+/* Performs mca(a qop b) on n limbs for finite a and b, and nonzero b */
+/* for a division */
+static __attribute__((always_inline)) inline double
+_mca_binary64_binary_op_fmp_n(const double a, const double b,
+                              const mca_operations qop, const mcamode mode,
+                              const int n) {
+  fixed_mp _A, _B, _RES;
+  _fmp_set_d(&_A, a, n);
+  _fmp_set_d(&_B, b, n);
+  if (mode == mcamode_pb || mode == mcamode_mca) {
+    _mca_inexact_fmp(&_A, mode, n);
+    _mca_inexact_fmp(&_B, mode, n);
+  }
+  switch (qop) {
+  case mca_add:
+    _fmp_add(&_RES, &_A, &_B, n);
+    break;
+  case mca_sub:
+    _fmp_sub(&_RES, &_A, &_B, n);
+    break;
+  case mca_mul:
+    _fmp_mul(&_RES, &_A, &_B, n);
+    break;
+  case mca_div:
+    _fmp_div(&_RES, &_A, &_B, n);
+    break;
+  default:
+    logger_error("invalid operator %c", qop);
+  }
+  if (mode == mcamode_rr || mode == mcamode_mca) {
+    _mca_inexact_fmp(&_RES, mode, n);
+  }
+  return _fmp_get_d(&_RES, n);
+}
+
+/* Performs mca(a qop b) with fixed_mp intermediates, the limb count is */
+/* a constant in each specialized call */
+static double _mca_binary64_binary_op_fmp(const double a, const double b,
+                                          const mca_operations qop,
+                                          const mcamode mode) {
+  switch (MCALIB_BINARY64_LIMBS) {
+  case 2:
+    return _mca_binary64_binary_op_fmp_n(a, b, qop, mode, 2);
+  case 3:
+    return _mca_binary64_binary_op_fmp_n(a, b, qop, mode, 3);
+  default:
+    return _mca_binary64_binary_op_fmp_n(a, b, qop, mode, 4);
+  }
+}
+
+/* Performs mca(a dop b) where a and b are binary32 values */
+/* Intermediate computations are performed with binary64 */
+static __attribute__((always_inline)) inline float
+_mca_binary32_binary_op(const float a, const float b, const mca_operations dop,
+                        void *context __attribute__((unused)),
+                        const mcamode mode, const bool daz, const bool ftz) {
+  _MCA_BINARY_OP(a, b, dop, mode, daz, ftz, (double)0);
+}
+
+/* Performs mca(a qop b) where a and b are binary64 values */
+/* Intermediate computations are performed with double-double when */
+/* possible, with fixed_mp above the binary128 precision and with */
+/* binary128 otherwise */
+static __attribute__((always_inline)) inline double
+_mca_binary64_binary_op(const double a, const double b,
+                        const mca_operations qop, void *context,
+                        const mcamode mode, const bool daz, const bool ftz) {
+  const t_context *ctx = (t_context *)context;
+  if (MCALIB_BINARY64_T <= DOUBLE_PREC && !ctx->binary64_quad) {
+    double _a = a, _b = b;
+    if (daz) {
+      _a = DAZ(a);
+      _b = DAZ(b);
+    }
+    if (mode == mcamode_ieee || _mca_dd_is_valid(_a, _b, qop)) {
+      double _res = 0;
+      if (mode == mcamode_ieee) {
+        /* same as rounding the binary128 result */
+        PERFORM_BIN_OP(qop, _res, _a, _b);
+      } else {
+        _res = _mca_binary64_binary_op_dd(_a, _b, qop, mode);
+      }
+      if (ftz) {
+        _res = FTZ(_res);
+      }
+      return _res;
+    }
+  } else if (MCALIB_BINARY64_T >= QUAD_PREC && mode != mcamode_ieee) {
+    double _a = a, _b = b;
+    if (daz) {
+      _a = DAZ(a);
+      _b = DAZ(b);
+    }
+    /* special values and divisions by zero use binary128, the noise */
+    /* does not change their result */
+    if (isfinite(_a) && isfinite(_b) && (_b != 0 || qop != mca_div)) {
+      double _res = _mca_binary64_binary_op_fmp(_a, _b, qop, mode);
+      if (ftz) {
+        _res = FTZ(_res);
+      }
+      return _res;
+    }
+  }
+  _MCA_BINARY_OP(a, b, qop, mode, daz, ftz, (__float128)0);
+}
+
+/************************* FPHOOKS FUNCTIONS *************************
+ * These functions correspond to those inserted into the source code
+ * during source to source compilation and are replacement to floating
+ * point operators
+ **********************************************************************/
+
+/* Defines the scalar and vector hooks of OPERATION on TYPE for the mode */
+/* MODE, with denormals-are-zero if DAZ and flush-to-zero if FTZ */
+#define DEFINE_MCA_HOOK(OPERATION, TYPE, BINARYN, MODE, DAZ, FTZ)              \
+  static void _interflop_##OPERATION##_##TYPE##_##MODE##_##DAZ##_##FTZ(        \
+      TYPE a, TYPE b, TYPE *c, void *context) {                                \
+    *c = _mca_##BINARYN##_binary_op(a, b, mca_##OPERATION, context,            \
+                                    mcamode_##MODE, DAZ, FTZ);                 \
+  }                                                                            \
+                                                                               \
+  static void _interflop_##OPERATION##_##TYPE##_vec_##MODE##_##DAZ##_##FTZ(    \
+      int width, const TYPE *a, const TYPE *b, TYPE *c, void *context) {       \
+    for (int i = 0; i < width; i++)                                            \
+      c[i] = _mca_##BINARYN##_binary_op(a[i], b[i], mca_##OPERATION, context,  \
+                                        mcamode_##MODE, DAZ, FTZ);             \
+  }
+
+#define DEFINE_MCA_HOOKS(MODE, DAZ, FTZ)                                       \
+  DEFINE_MCA_HOOK(add, float, binary32, MODE, DAZ, FTZ)                        \
+  DEFINE_MCA_HOOK(sub, float, binary32, MODE, DAZ, FTZ)                        \
+  DEFINE_MCA_HOOK(mul, float, binary32, MODE, DAZ, FTZ)                        \
+  DEFINE_MCA_HOOK(div, float, binary32, MODE, DAZ, FTZ)                        \
+  DEFINE_MCA_HOOK(add, double, binary64, MODE, DAZ, FTZ)                       \
+  DEFINE_MCA_HOOK(sub, double, binary64, MODE, DAZ, FTZ)                       \
+  DEFINE_MCA_HOOK(mul, double, binary64, MODE, DAZ, FTZ)                       \
+  DEFINE_MCA_HOOK(div, double, binary64, MODE, DAZ, FTZ)
+
+#define DEFINE_MCA_MODE_HOOKS(MODE)                                            \
+  DEFINE_MCA_HOOKS(MODE, 0, 0)                                                 \
+  DEFINE_MCA_HOOKS(MODE, 0, 1)                                                 \
+  DEFINE_MCA_HOOKS(MODE, 1, 0)                                                 \
+  DEFINE_MCA_HOOKS(MODE, 1, 1)
+
+DEFINE_MCA_MODE_HOOKS(ieee)
+DEFINE_MCA_MODE_HOOKS(mca)
+DEFINE_MCA_MODE_HOOKS(pb)
+DEFINE_MCA_MODE_HOOKS(rr)
+
+/* Interface of the hooks specialized for MODE, DAZ and FTZ */
+#define MCA_BACKEND(MODE, DAZ, FTZ)                                            \
+  {                                                                            \
+    _interflop_add_float_##MODE##_##DAZ##_##FTZ,                               \
+        _interflop_sub_float_##MODE##_##DAZ##_##FTZ,                           \
+        _interflop_mul_float_##MODE##_##DAZ##_##FTZ,                           \
+        _interflop_div_float_##MODE##_##DAZ##_##FTZ, NULL,                     \
+        _interflop_add_double_##MODE##_##DAZ##_##FTZ,                          \
+        _interflop_sub_double_##MODE##_##DAZ##_##FTZ,                          \
+        _interflop_mul_double_##MODE##_##DAZ##_##FTZ,                          \
+        _interflop_div_double_##MODE##_##DAZ##_##FTZ, NULL, NULL, NULL, NULL,  \
+        _interflop_add_float_vec_##MODE##_##DAZ##_##FTZ,                       \
+        _interflop_sub_float_vec_##MODE##_##DAZ##_##FTZ,                       \
+        _interflop_mul_float_vec_##MODE##_##DAZ##_##FTZ,                       \
+        _interflop_div_float_vec_##MODE##_##DAZ##_##FTZ,                       \
+        _interflop_add_double_vec_##MODE##_##DAZ##_##FTZ,                      \
+        _interflop_sub_double_vec_##MODE##_##DAZ##_##FTZ,                      \
+        _interflop_mul_double_vec_##MODE##_##DAZ##_##FTZ,                      \
+        _interflop_div_double_vec_##MODE##_##DAZ##_##FTZ                       \
+  }
+
+#define MCA_MODE_BACKENDS(MODE)                                                \
+  {                                                                            \
+    {MCA_BACKEND(MODE, 0, 0), MCA_BACKEND(MODE, 0, 1)},                        \
+        {MCA_BACKEND(MODE, 1, 0), MCA_BACKEND(MODE, 1, 1)},                    \
+  }
+
+/* Interfaces indexed by mode, daz and ftz */
+static const struct interflop_backend_interface_t
+    mca_backends[_mcamode_end_][2][2] = {
+        [mcamode_ieee] = MCA_MODE_BACKENDS(ieee),
+        [mcamode_mca] = MCA_MODE_BACKENDS(mca),
+        [mcamode_pb] = MCA_MODE_BACKENDS(pb),
+        [mcamode_rr] = MCA_MODE_BACKENDS(rr)};
+
 static struct argp_option options[] = {
     {key_prec_b32_str, KEY_PREC_B32, "PRECISION", 0,
      "select precision for binary32 (PRECISION > 0)", 0},
@@ -359,10 +687,16 @@ static struct argp_option options[] = {
     {key_mode_str, KEY_MODE, "MODE", 0,
      "select MCA mode among {ieee, mca, pb, rr}", 0},
     {key_seed_str, KEY_SEED, "SEED", 0, "fix the random generator seed", 0},
+    {key_rng_str, KEY_RNG, "RNG", 0,
+     "select the random generator among {tinymt64, philox}", 0},
     {key_daz_str, KEY_DAZ, 0, 0,
      "denormals-are-zero: sets denormals inputs to zero", 0},
     {key_ftz_str, KEY_FTZ, 0, 0, "flush-to-zero: sets denormal output to zero",
      0},
+    {key_binary64_quad_str, KEY_BINARY64_QUAD, 0, 0,
+     "compute binary64 operations with binary128 instead of double-double "
+     "intermediates",
+     0},
     {0}};
 
 error_t parse_opt(int key, char *arg, struct argp_state *state) {
@@ -418,6 +752,14 @@ error_t parse_opt(int key, char *arg, struct argp_state *state) {
                    key_seed_str);
     }
     break;
+  case KEY_RNG:
+    /* random generator */
+    if (!_parse_rng_kind(arg, &ctx->rng_kind)) {
+      logger_error("--%s invalid value provided, must be one of: "
+                   "{tinymt64, philox}.",
+                   key_rng_str);
+    }
+    break;
   case KEY_DAZ:
     /* denormals-are-zero */
     ctx->daz = true;
@@ -426,6 +768,10 @@ error_t parse_opt(int key, char *arg, struct argp_state *state) {
     /* flush-to-zero */
     ctx->ftz = true;
     break;
+  case KEY_BINARY64_QUAD:
+    /* binary128 intermediates for binary64 */
+    ctx->binary64_quad = true;
+    break;
   default:
     return ARGP_ERR_UNKNOWN;
   }
@@ -438,7 +784,9 @@ void init_context(t_context *ctx) {
   ctx->choose_seed = false;
   ctx->daz = false;
   ctx->ftz = false;
+  ctx->binary64_quad = false;
   ctx->seed = 0ULL;
+  ctx->rng_kind = rng_tinymt64;
 }
 
 void print_information_header(void *context) {
@@ -476,23 +824,13 @@ struct interflop_backend_interface_t interflop_init(int argc, char **argv,
 
   print_information_header(ctx);
 
-  struct interflop_backend_interface_t interflop_backend_mca = {
-      _interflop_add_float,
-      _interflop_sub_float,
-      _interflop_mul_float,
-      _interflop_div_float,
-      NULL,
-      _interflop_add_double,
-      _interflop_sub_double,
-      _interflop_mul_double,
-      _interflop_div_double,
-      NULL,
-      NULL,
-      NULL,
-      NULL};
+  /* The hooks are specialized at compile time for each mode, daz and */
+  /* ftz combination, select the ones matching the options */
+  struct interflop_backend_interface_t interflop_backend_mca =
+      mca_backends[MCALIB_MODE][ctx->daz][ctx->ftz];
 
   /* Initialize the seed */
-  _set_mca_seed(ctx->choose_seed, ctx->seed);
+  _set_mca_seed(ctx->rng_kind, ctx->choose_seed, ctx->seed);
 
   return interflop_backend_mca;
 }
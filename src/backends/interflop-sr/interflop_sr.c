@@ -0,0 +1,307 @@
+/*****************************************************************************
+ *                                                                           *
+ *  This file is part of Verificarlo.                                        *
+ *                                                                           *
+ *  Copyright (c) 2020                                                       *
+ *     Verificarlo contributors                                              *
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *
+ *                                                                           *
+ *  Verificarlo is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by     *
+ *  the Free Software Foundation, either version 3 of the License, or        *
+ *  (at your option) any later version.                                      *
+ *                                                                           *
+ *  Verificarlo is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *  GNU General Public License for more details.                             *
+ *                                                                           *
+ *  You should have received a copy of the GNU General Public License        *
+ *  along with Verificarlo.  If not, see <http://www.gnu.org/licenses/>.     *
+ *                                                                           *
+ *****************************************************************************/
+
+/* Stochastic rounding backend
+ *
+ * Each operation is first computed in round-to-nearest together with its
+ * rounding error, obtained with error-free transformations. The result is
+ * then moved to the other floating-point neighbour of the exact result with
+ * a probability proportional to that error. No wider format is involved, so
+ * an operation costs a small constant factor over the native one.
+ */
+
+#include <argp.h>
+#include <err.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+
+#include "../../common/float_const.h"
+#include "../../common/float_struct.h"
+#include "../../common/float_utils.h"
+#include "../../common/interflop.h"
+#include "../../common/logger.h"
+#include "../../common/options.h"
+
+typedef enum { KEY_RNG, KEY_SEED = 's' } key_args;
+
+static const char key_seed_str[] = "seed";
+static const char key_rng_str[] = "rng";
+
+typedef struct {
+  bool choose_seed;
+  uint64_t seed;
+  rng_kind_t rng_kind;
+} t_context;
+
+/* Number of vector elements rounded at once by the vector hooks */
+#define SR_CHUNK_SIZE 16
+
+/******************** SR RANDOM FUNCTIONS ********************/
+
+/* random generator internal state, one per thread */
+static __thread rng_state_t rng_state;
+
+/* random generator configuration shared by all the threads */
+static rng_config_t rng_config = {rng_tinymt64, false, 0};
+
+static double _sr_rand(void) {
+  /* Returns a random double in the (0,1) open interval */
+  return _rng_generate_doubleOO(&rng_state, &rng_config);
+}
+
+/* Set the sr seed */
+static void _set_sr_seed(const rng_kind_t rng_kind, const bool choose_seed,
+                         const uint64_t seed) {
+  rng_config.kind = rng_kind;
+  rng_config.choose_seed = choose_seed;
+  rng_config.seed = seed;
+  _init_rng_state(&rng_state, &rng_config);
+}
+
+/******************** SR ERROR-FREE TRANSFORMATIONS ********************
+ * Each function returns the round-to-nearest result x of the operation
+ * and stores in e the error such that x + e is the exact result. e is
+ * exact for additions and subtractions, exact for multiplications that do
+ * not underflow, and accurate to a few ulps for divisions, which is enough
+ * for the rounding probability. binary32 errors are kept in binary64.
+ ***********************************************************************/
+
+static inline float _sr_add_binary32(const float a, const float b, double *e) {
+  const float s = a + b;
+  const float bb = s - a;
+  *e = (double)((a - (s - bb)) + (b - bb));
+  return s;
+}
+
+static inline float _sr_sub_binary32(const float a, const float b, double *e) {
+  return _sr_add_binary32(a, -b, e);
+}
+
+static inline float _sr_mul_binary32(const float a, const float b, double *e) {
+  /* the 48 bits product is exact in binary64 */
+  const double p = (double)a * (double)b;
+  const float x = (float)p;
+  *e = p - x;
+  return x;
+}
+
+static inline float _sr_div_binary32(const float a, const float b, double *e) {
+  const float x = a / b;
+  /* x * b is exact in binary64 and close enough to a for the residual */
+  /* a - x * b to be exact too */
+  *e = ((double)a - (double)x * (double)b) / b;
+  return x;
+}
+
+static inline double _sr_add_binary64(const double a, const double b,
+                                      double *e) {
+  const double_double s = _dd_two_sum(a, b);
+  *e = s.lo;
+  return s.hi;
+}
+
+static inline double _sr_sub_binary64(const double a, const double b,
+                                      double *e) {
+  return _sr_add_binary64(a, -b, e);
+}
+
+static inline double _sr_mul_binary64(const double a, const double b,
+                                      double *e) {
+  const double_double p = _dd_two_prod(a, b);
+  *e = p.lo;
+  return p.hi;
+}
+
+static inline double _sr_div_binary64(const double a, const double b,
+                                      double *e) {
+  const double x = a / b;
+  /* x * b is close to a, so a - p.hi is exact and a - x * b is the */
+  /* exact residual */
+  const double_double p = _dd_two_prod(x, b);
+  *e = ((a - p.hi) - p.lo) / b;
+  return x;
+}
+
+/******************** SR ROUNDING FUNCTIONS ********************
+ * x + e is rounded to the neighbour of x on the side of e with
+ * probability |e| / |neighbour - x| and to x otherwise. u is uniform in
+ * (0,1). The functions have no branch so that the vector hooks loops
+ * vectorize: when e is zero or x or e is not finite, the comparison is
+ * false and x is returned.
+ ***************************************************************/
+
+static inline float _sr_round_binary32(const float x, const double e,
+                                       const double u) {
+  binary32 y = {.f32 = (x == 0) ? copysignf(0.0f, e) : x};
+  /* moving away from zero increments the encoding */
+  y.u32 += ((e < 0) == (y.s32 < 0)) ? 1 : -1;
+  return (u * fabs((double)y.f32 - x) < fabs(e)) ? y.f32 : x;
+}
+
+static inline double _sr_round_binary64(const double x, const double e,
+                                        const double u) {
+  binary64 y = {.f64 = (x == 0) ? copysign(0.0, e) : x};
+  /* moving away from zero increments the encoding */
+  y.u64 += ((e < 0) == (y.s64 < 0)) ? 1 : -1;
+  return (u * fabs(y.f64 - x) < fabs(e)) ? y.f64 : x;
+}
+
+/************************* FPHOOKS FUNCTIONS *************************
+ * The scalar hooks only draw a random number for inexact operations.
+ * The vector hooks compute the results and errors of a chunk, draw one
+ * random number per element and round the chunk.
+ **********************************************************************/
+
+#define DEFINE_SR_HOOKS(OPERATION, TYPE, BINARYN)                              \
+  static void _interflop_##OPERATION##_##TYPE(                                 \
+      TYPE a, TYPE b, TYPE *c, void *context __attribute__((unused))) {        \
+    double e;                                                                  \
+    const TYPE x = _sr_##OPERATION##_##BINARYN(a, b, &e);                      \
+    *c = (e == 0) ? x : _sr_round_##BINARYN(x, e, _sr_rand());                 \
+  }                                                                            \
+                                                                               \
+  static void _interflop_##OPERATION##_##TYPE##_vec(                           \
+      int width, const TYPE *a, const TYPE *b, TYPE *c,                        \
+      void *context __attribute__((unused))) {                                 \
+    TYPE x[SR_CHUNK_SIZE];                                                     \
+    double e[SR_CHUNK_SIZE], u[SR_CHUNK_SIZE];                                 \
+    for (int i = 0; i < width; i += SR_CHUNK_SIZE) {                           \
+      const int n = (width - i < SR_CHUNK_SIZE) ? width - i : SR_CHUNK_SIZE;   \
+      for (int j = 0; j < n; j++) {                                            \
+        x[j] = _sr_##OPERATION##_##BINARYN(a[i + j], b[i + j], &e[j]);         \
+      }                                                                        \
+      for (int j = 0; j < n; j++) {                                            \
+        u[j] = _sr_rand();                                                     \
+      }                                                                        \
+      for (int j = 0; j < n; j++) {                                            \
+        c[i + j] = _sr_round_##BINARYN(x[j], e[j], u[j]);                      \
+      }                                                                        \
+    }                                                                          \
+  }
+
+DEFINE_SR_HOOKS(add, float, binary32)
+DEFINE_SR_HOOKS(sub, float, binary32)
+DEFINE_SR_HOOKS(mul, float, binary32)
+DEFINE_SR_HOOKS(div, float, binary32)
+DEFINE_SR_HOOKS(add, double, binary64)
+DEFINE_SR_HOOKS(sub, double, binary64)
+DEFINE_SR_HOOKS(mul, double, binary64)
+DEFINE_SR_HOOKS(div, double, binary64)
+
+static struct argp_option options[] = {
+    {key_seed_str, KEY_SEED, "SEED", 0, "fix the random generator seed", 0},
+    {key_rng_str, KEY_RNG, "RNG", 0,
+     "select the random generator among {tinymt64, philox}", 0},
+    {0}};
+
+static error_t parse_opt(int key, char *arg, struct argp_state *state) {
+  t_context *ctx = (t_context *)state->input;
+  char *endptr;
+  switch (key) {
+  case KEY_SEED:
+    /* seed */
+    errno = 0;
+    ctx->choose_seed = true;
+    ctx->seed = strtoull(arg, &endptr, 10);
+    if (errno != 0) {
+      logger_error("--%s invalid value provided, must be an integer",
+                   key_seed_str);
+    }
+    break;
+  case KEY_RNG:
+    /* random generator */
+    if (!_parse_rng_kind(arg, &ctx->rng_kind)) {
+      logger_error("--%s invalid value provided, must be one of: "
+                   "{tinymt64, philox}.",
+                   key_rng_str);
+    }
+    break;
+  default:
+    return ARGP_ERR_UNKNOWN;
+  }
+  return 0;
+}
+
+static struct argp argp = {options, parse_opt, "", "", NULL, NULL, NULL};
+
+static void init_context(t_context *ctx) {
+  ctx->choose_seed = false;
+  ctx->seed = 0ULL;
+  ctx->rng_kind = rng_tinymt64;
+}
+
+static void print_information_header(void *context) {
+  t_context *ctx = (t_context *)context;
+
+  logger_info("load backend with %s = %s\n", key_rng_str,
+              RNG_KIND_STR[ctx->rng_kind]);
+}
+
+struct interflop_backend_interface_t interflop_init(int argc, char **argv,
+                                                    void **context) {
+
+  /* Initialize the logger */
+  logger_init();
+
+  t_context *ctx = malloc(sizeof(t_context));
+  *context = ctx;
+  init_context(ctx);
+
+  /* parse backend arguments */
+  argp_parse(&argp, argc, argv, 0, 0, ctx);
+
+  print_information_header(ctx);
+
+  struct interflop_backend_interface_t interflop_backend_sr = {
+      _interflop_add_float,
+      _interflop_sub_float,
+      _interflop_mul_float,
+      _interflop_div_float,
+      NULL,
+      _interflop_add_double,
+      _interflop_sub_double,
+      _interflop_mul_double,
+      _interflop_div_double,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      _interflop_add_float_vec,
+      _interflop_sub_float_vec,
+      _interflop_mul_float_vec,
+      _interflop_div_float_vec,
+      _interflop_add_double_vec,
+      _interflop_sub_double_vec,
+      _interflop_mul_double_vec,
+      _interflop_div_double_vec};
+
+  /* Initialize the seed */
+  _set_sr_seed(ctx->rng_kind, ctx->choose_seed, ctx->seed);
+
+  return interflop_backend_sr;
+}
@@ -47,7 +47,7 @@
 #include "../../common/float_utils.h"
 #include "../../common/interflop.h"
 #include "../../common/logger.h"
-#include "../../common/vfc_hashmap.h"
+#include "../../common/vfc_concurrent_map.h"
 #include "../../common/vprec_tools.h"
 
 typedef enum {
@@ -127,12 +127,6 @@ static int VPRECLIB_BINARY64_PRECISION = VPREC_PRECISION_BINARY64_DEFAULT;
 static int VPRECLIB_BINARY32_RANGE = VPREC_RANGE_BINARY32_DEFAULT;
 static int VPRECLIB_BINARY64_RANGE = VPREC_RANGE_BINARY64_DEFAULT;
 
-static float _vprec_binary32_binary_op(float a, float b,
-                                       const vprec_operation op, void *context);
-static double _vprec_binary64_binary_op(double a, double b,
-                                        const vprec_operation op,
-                                        void *context);
-
 /* variables and structure for instrumentation mode */
 
 /* define instrumentation modes */
@@ -271,8 +265,11 @@ void _set_vprec_inst_mode(vprec_inst_mode mode) {
   };
 
 // Round the float with the given precision
-static float _vprec_round_binary32(float a, char is_input, void *context,
-                                   int binary32_range, int binary32_precision) {
+// Denormals are set to zero if flush_denormal, that is with daz for the
+// inputs and ftz for the outputs
+static inline float _vprec_round_binary32(float a, const bool flush_denormal,
+                                          int binary32_range,
+                                          int binary32_precision) {
   if (!isfinite(a)) {
     return a;
   }
@@ -294,8 +291,7 @@ static float _vprec_round_binary32(float a, char is_input, void *context,
   }
 
   if (aexp.s32 <= emin) {
-    if ((((t_context *)context)->daz && is_input) ||
-        (((t_context *)context)->ftz && !is_input)) {
+    if (flush_denormal) {
       a = 0;
     } else {
       a = handle_binary32_denormal(a, emin, aexp.u32, binary32_precision);
@@ -320,9 +316,11 @@ static float _vprec_round_binary32(float a, char is_input, void *context,
 }
 
 // Round the double with the given precision
-static double _vprec_round_binary64(double a, char is_input, void *context,
-                                    int binary64_range,
-                                    int binary64_precision) {
+// Denormals are set to zero if flush_denormal, that is with daz for the
+// inputs and ftz for the outputs
+static inline double _vprec_round_binary64(double a, const bool flush_denormal,
+                                           int binary64_range,
+                                           int binary64_precision) {
   /* test if a or b are special cases */
   if (!isfinite(a)) {
     return a;
@@ -345,8 +343,7 @@ static double _vprec_round_binary64(double a, char is_input, void *context,
   }
 
   if (aexp.s64 <= emin) {
-    if ((((t_context *)context)->daz && is_input) ||
-        (((t_context *)context)->ftz && !is_input)) {
+    if (flush_denormal) {
       a = 0;
     } else {
       a = handle_binary64_denormal(a, emin, aexp.u64, binary64_precision);
@@ -369,44 +366,47 @@ static double _vprec_round_binary64(double a, char is_input, void *context,
   return a;
 }
 
-static inline float _vprec_binary32_binary_op(float a, float b,
-                                              const vprec_operation op,
-                                              void *context) {
+// mode, daz and ftz are compile-time constants in the specialized hooks
+static __attribute__((always_inline)) inline float
+_vprec_binary32_binary_op(float a, float b, const vprec_operation op,
+                          const vprec_mode mode, const bool daz,
+                          const bool ftz) {
   float res = 0;
 
-  if ((VPRECLIB_MODE == vprecmode_full) || (VPRECLIB_MODE == vprecmode_ib)) {
-    a = _vprec_round_binary32(a, 1, context, VPRECLIB_BINARY32_RANGE,
+  if ((mode == vprecmode_full) || (mode == vprecmode_ib)) {
+    a = _vprec_round_binary32(a, daz, VPRECLIB_BINARY32_RANGE,
                               VPRECLIB_BINARY32_PRECISION);
-    b = _vprec_round_binary32(b, 1, context, VPRECLIB_BINARY32_RANGE,
+    b = _vprec_round_binary32(b, daz, VPRECLIB_BINARY32_RANGE,
                               VPRECLIB_BINARY32_PRECISION);
   }
 
   perform_binary_op(op, res, a, b);
 
-  if ((VPRECLIB_MODE == vprecmode_full) || (VPRECLIB_MODE == vprecmode_ob)) {
-    res = _vprec_round_binary32(res, 0, context, VPRECLIB_BINARY32_RANGE,
+  if ((mode == vprecmode_full) || (mode == vprecmode_ob)) {
+    res = _vprec_round_binary32(res, ftz, VPRECLIB_BINARY32_RANGE,
                                 VPRECLIB_BINARY32_PRECISION);
   }
 
   return res;
 }
 
-static inline double _vprec_binary64_binary_op(double a, double b,
-                                               const vprec_operation op,
-                                               void *context) {
+static __attribute__((always_inline)) inline double
+_vprec_binary64_binary_op(double a, double b, const vprec_operation op,
+                          const vprec_mode mode, const bool daz,
+                          const bool ftz) {
   double res = 0;
 
-  if ((VPRECLIB_MODE == vprecmode_full) || (VPRECLIB_MODE == vprecmode_ib)) {
-    a = _vprec_round_binary64(a, 1, context, VPRECLIB_BINARY64_RANGE,
+  if ((mode == vprecmode_full) || (mode == vprecmode_ib)) {
+    a = _vprec_round_binary64(a, daz, VPRECLIB_BINARY64_RANGE,
                               VPRECLIB_BINARY64_PRECISION);
-    b = _vprec_round_binary64(b, 1, context, VPRECLIB_BINARY64_RANGE,
+    b = _vprec_round_binary64(b, daz, VPRECLIB_BINARY64_RANGE,
                               VPRECLIB_BINARY64_PRECISION);
   }
 
   perform_binary_op(op, res, a, b);
 
-  if ((VPRECLIB_MODE == vprecmode_full) || (VPRECLIB_MODE == vprecmode_ob)) {
-    res = _vprec_round_binary64(res, 0, context, VPRECLIB_BINARY64_RANGE,
+  if ((mode == vprecmode_full) || (mode == vprecmode_ob)) {
+    res = _vprec_round_binary64(res, ftz, VPRECLIB_BINARY64_RANGE,
                                 VPRECLIB_BINARY64_PRECISION);
   }
 
@@ -421,7 +421,7 @@ static inline double _vprec_binary64_binary_op(double a, double b,
  * the desired precision or to round arguments, depending on the mode.
  *************************************************************************/
 
-vfc_hashmap_t _vprec_func_map;
+vfc_concurrent_map_t _vprec_func_map;
 
 /* type (4 bits) | range (6 bits) | precision (6 bits) */
 typedef unsigned short _vprec_func_precision_t;
@@ -537,55 +537,78 @@ void _vprec_read_hasmap(FILE *fin) {
       }
     }
 
-    // insert in the hashmap
+    // insert in the hashmap, the first occurrence of an id is kept
     _vprec_inst_function_t *adress = malloc(sizeof(_vprec_inst_function_t));
     (*adress) = function;
-    vfc_hashmap_insert(_vprec_func_map, vfc_hashmap_str_function(function.id),
-                       adress);
+    if (vfc_concurrent_map_insert(_vprec_func_map, adress->id, adress) !=
+        adress) {
+      free(adress->input_arguments);
+      free(adress->output_arguments);
+      free(adress);
+    }
   }
 }
 
-void _vprec_write_hasmap(FILE *fout) {
-  for (int ii = 0; ii < _vprec_func_map->capacity; ii++) {
-    if (get_value_at(_vprec_func_map->items, ii) != 0 &&
-        get_value_at(_vprec_func_map->items, ii) != 0) {
-      _vprec_inst_function_t *function =
-          (_vprec_inst_function_t *)get_value_at(_vprec_func_map->items, ii);
-
-      fprintf(fout, "%s\t%hu\t%hu\t%hu\t%hu\t%d\t%d\t%d\n", function->id,
-              get_vprec_func_precision_mantissa(function->precision_binary64),
-              get_vprec_func_precision_exponent(function->precision_binary64),
-              get_vprec_func_precision_mantissa(function->precision_binary32),
-              get_vprec_func_precision_exponent(function->precision_binary32),
-              function->nb_input_args, function->nb_output_args,
-              function->n_calls);
-      for (int i = 0; i < function->nb_input_args; i++) {
-        fprintf(
-            fout, "input:\t%hu\t%hu\t%hu\n",
+static void _vprec_write_function(const char *id __attribute__((unused)),
+                                  void *item, void *f) {
+  _vprec_inst_function_t *function = (_vprec_inst_function_t *)item;
+  FILE *fout = (FILE *)f;
+
+  fprintf(fout, "%s\t%hu\t%hu\t%hu\t%hu\t%d\t%d\t%d\n", function->id,
+          get_vprec_func_precision_mantissa(function->precision_binary64),
+          get_vprec_func_precision_exponent(function->precision_binary64),
+          get_vprec_func_precision_mantissa(function->precision_binary32),
+          get_vprec_func_precision_exponent(function->precision_binary32),
+          function->nb_input_args, function->nb_output_args,
+          function->n_calls);
+  for (int i = 0; i < function->nb_input_args; i++) {
+    fprintf(fout, "input:\t%hu\t%hu\t%hu\n",
             get_vprec_func_precision_type(function->input_arguments[i]),
             get_vprec_func_precision_mantissa(function->input_arguments[i]),
             get_vprec_func_precision_exponent(function->input_arguments[i]));
-      }
-      for (int i = 0; i < function->nb_output_args; i++) {
-        fprintf(
-            fout, "output:\t%hu\t%hu\t%hu\n",
+  }
+  for (int i = 0; i < function->nb_output_args; i++) {
+    fprintf(fout, "output:\t%hu\t%hu\t%hu\n",
             get_vprec_func_precision_type(function->output_arguments[i]),
             get_vprec_func_precision_mantissa(function->output_arguments[i]),
             get_vprec_func_precision_exponent(function->output_arguments[i]));
-      }
-    }
   }
 }
 
-void _interflop_enter_function(interflop_function_stack_t *stack, void *context,
-                               int nb_args, va_list ap) {
-  interflop_function_info_t *function_info = stack->array[stack->top];
+void _vprec_write_hasmap(FILE *fout) {
+  vfc_concurrent_map_foreach(_vprec_func_map, _vprec_write_function, fout);
+}
 
-  if (function_info == NULL)
-    logger_error("Call stack error\n");
+/* The function of a call site is also kept in the backend_data field of its
+ * descriptor, so that enter and exit functions do not hash the id. The
+ * descriptors are unique even when several instrumented modules are loaded,
+ * unlike the ids of their call sites. */
+
+// find the function of a call site, NULL if it was never called and is not
+// in the input file
+static _vprec_inst_function_t *
+_vprec_func_find(interflop_function_info_t *function_info) {
+  void **slot = &function_info->backend_data;
+  _vprec_inst_function_t *function_inst =
+      __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+  if (function_inst != NULL) {
+    return function_inst;
+  }
 
-  _vprec_inst_function_t *function_inst = vfc_hashmap_get(
-      _vprec_func_map, vfc_hashmap_str_function(function_info->id));
+  function_inst = vfc_concurrent_map_get(_vprec_func_map, function_info->id);
+
+  // the hashmap gives the same function to all threads
+  if (function_inst != NULL) {
+    __atomic_store_n(slot, function_inst, __ATOMIC_RELEASE);
+  }
+  return function_inst;
+}
+
+// get the function of a call site, it is added to the hashmap on the first
+// call to a function which is not in the input file
+static _vprec_inst_function_t *
+_vprec_func_get(interflop_function_info_t *function_info) {
+  _vprec_inst_function_t *function_inst = _vprec_func_find(function_info);
 
   // if the function is not in the hashtable
   if (function_inst == NULL) {
@@ -604,12 +627,46 @@ void _interflop_enter_function(interflop_function_stack_t *stack, void *context,
     function_inst->output_arguments = NULL;
     function_inst->n_calls = 0;
 
-    // insert the function in the hashmap
-    vfc_hashmap_insert(_vprec_func_map,
-                       vfc_hashmap_str_function(function_info->id),
-                       function_inst);
+    // insert the function in the hashmap, unless another thread did
+    _vprec_inst_function_t *added =
+        vfc_concurrent_map_insert(_vprec_func_map, function_inst->id,
+                                  function_inst);
+    if (added != function_inst) {
+      free(function_inst);
+      function_inst = added;
+    }
+    __atomic_store_n(&function_info->backend_data, function_inst,
+                     __ATOMIC_RELEASE);
   }
 
+  return function_inst;
+}
+
+// precisions of the operations outside of the instrumented functions, given
+// by the options
+static _vprec_func_precision_t _vprec_options_binary64;
+static _vprec_func_precision_t _vprec_options_binary32;
+
+// set the precisions of the operations
+static void _vprec_set_func_precisions(_vprec_func_precision_t binary64,
+                                       _vprec_func_precision_t binary32) {
+  _set_vprec_precision_binary64(get_vprec_func_precision_mantissa(binary64));
+  _set_vprec_range_binary64(get_vprec_func_precision_exponent(binary64));
+  _set_vprec_precision_binary32(get_vprec_func_precision_mantissa(binary32));
+  _set_vprec_range_binary32(get_vprec_func_precision_exponent(binary32));
+}
+
+void _interflop_enter_function(interflop_function_stack_t *stack, void *context,
+                               const interflop_function_signature_t *signature,
+                               void *values) {
+  const int nb_args = signature->nb_args;
+  interflop_function_info_t *function_info = stack->array[stack->top];
+
+  if (function_info == NULL)
+    logger_error("Call stack error\n");
+
+  _vprec_inst_function_t *function_inst = _vprec_func_get(function_info);
+
   // increment the number of calls
   function_inst->n_calls++;
 
@@ -617,37 +674,41 @@ void _interflop_enter_function(interflop_function_stack_t *stack, void *context,
   if (!function_info->isLibraryFunction &&
       !function_info->isIntrinsicFunction && VPREC_INST_MODE != vprecinst_arg &&
       VPREC_INST_MODE != vprecinst_none) {
-    _set_vprec_precision_binary64(
-        get_vprec_func_precision_mantissa(function_inst->precision_binary64));
-    _set_vprec_range_binary64(
-        get_vprec_func_precision_exponent(function_inst->precision_binary64));
-    _set_vprec_precision_binary32(
-        get_vprec_func_precision_mantissa(function_inst->precision_binary32));
-    _set_vprec_range_binary32(
-        get_vprec_func_precision_exponent(function_inst->precision_binary32));
+    _vprec_set_func_precisions(function_inst->precision_binary64,
+                               function_inst->precision_binary32);
   }
 
   // if input arguments are not in the structure
-  if (function_inst->input_arguments == NULL && nb_args > 0) {
-    function_inst->input_arguments =
+  if (__atomic_load_n(&function_inst->input_arguments, __ATOMIC_ACQUIRE) ==
+          NULL &&
+      nb_args > 0) {
+    _vprec_func_precision_t *input_arguments =
         malloc(sizeof(_vprec_func_precision_t) * nb_args);
-    function_inst->nb_input_args = nb_args;
 
     for (int i = 0; i < nb_args; i++) {
-      int type = va_arg(ap, int);
-      void *value = va_arg(ap, void *);
+      const int type = signature->args[i].type;
 
       if (type == FDOUBLE) {
-        function_inst->input_arguments[i] =
+        input_arguments[i] =
             set_vprec_func_precision(FDOUBLE, VPREC_RANGE_BINARY64_DEFAULT,
                                      VPREC_PRECISION_BINARY64_DEFAULT);
       } else if (type == FFLOAT) {
-        function_inst->input_arguments[i] =
+        input_arguments[i] =
             set_vprec_func_precision(FFLOAT, VPREC_RANGE_BINARY32_DEFAULT,
                                      VPREC_PRECISION_BINARY32_DEFAULT);
       }
     }
 
+    // publish the arguments, unless another thread did
+    _vprec_func_precision_t *expected = NULL;
+    if (__atomic_compare_exchange_n(&function_inst->input_arguments, &expected,
+                                    input_arguments, false, __ATOMIC_RELEASE,
+                                    __ATOMIC_RELAXED)) {
+      function_inst->nb_input_args = nb_args;
+    } else {
+      free(input_arguments);
+    }
+
     // round to default value is useless, so exit
     return;
   }
@@ -658,18 +719,19 @@ void _interflop_enter_function(interflop_function_stack_t *stack, void *context,
        (VPREC_INST_MODE == vprecinst_arg)) &&
       VPREC_INST_MODE != vprecinst_none) {
     for (int i = 0; i < nb_args; i++) {
-      int type = va_arg(ap, int);
+      const int type = signature->args[i].type;
+      char *address = (char *)values + signature->args[i].offset;
 
       if (type == FDOUBLE) {
-        double *value = va_arg(ap, double *);
-        *value = _vprec_round_binary64(*value, 1, context,
+        double *value = (double *)address;
+        *value = _vprec_round_binary64(*value, ((t_context *)context)->daz,
                                        get_vprec_func_precision_exponent(
                                            function_inst->input_arguments[i]),
                                        get_vprec_func_precision_mantissa(
                                            function_inst->input_arguments[i]));
       } else if (type == FFLOAT) {
-        float *value = va_arg(ap, float *);
-        *value = _vprec_round_binary32(*value, 1, context,
+        float *value = (float *)address;
+        *value = _vprec_round_binary32(*value, ((t_context *)context)->daz,
                                        get_vprec_func_precision_exponent(
                                            function_inst->input_arguments[i]),
                                        get_vprec_func_precision_mantissa(
@@ -680,58 +742,67 @@ void _interflop_enter_function(interflop_function_stack_t *stack, void *context,
 }
 
 void _interflop_exit_function(interflop_function_stack_t *stack, void *context,
-                              int nb_args, va_list ap) {
+                              const interflop_function_signature_t *signature,
+                              void *values) {
+  const int nb_args = signature->nb_args;
   interflop_function_info_t *function_info = stack->array[stack->top];
 
   if (function_info == NULL)
     logger_error("Call stack error \n");
 
-  _vprec_inst_function_t *function_inst = vfc_hashmap_get(
-      _vprec_func_map, vfc_hashmap_str_function(function_info->id));
+  _vprec_inst_function_t *function_inst = _vprec_func_get(function_info);
 
-  if (stack->array[stack->top + 1] != NULL) {
+  // restore the precision of the caller. Calls without floating point values
+  // are not instrumented, the caller is the closest instrumented call, or
+  // the code outside of the instrumented calls at the bottom of the stack.
+  if (VPREC_INST_MODE != vprecinst_arg && VPREC_INST_MODE != vprecinst_none) {
     interflop_function_info_t *parent_info = stack->array[stack->top + 1];
 
-    if (!parent_info->isLibraryFunction && !parent_info->isIntrinsicFunction &&
-        VPREC_INST_MODE != vprecinst_arg && VPREC_INST_MODE != vprecinst_none) {
-
-      _vprec_inst_function_t *function_parent = vfc_hashmap_get(
-          _vprec_func_map, vfc_hashmap_str_function(parent_info->id));
+    if (parent_info == NULL) {
+      _vprec_set_func_precisions(_vprec_options_binary64,
+                                 _vprec_options_binary32);
+    } else if (!parent_info->isLibraryFunction &&
+               !parent_info->isIntrinsicFunction) {
+      _vprec_inst_function_t *function_parent = _vprec_func_find(parent_info);
 
       if (function_parent != NULL) {
-        _set_vprec_precision_binary64(get_vprec_func_precision_mantissa(
-            function_parent->precision_binary64));
-        _set_vprec_range_binary64(get_vprec_func_precision_exponent(
-            function_parent->precision_binary64));
-        _set_vprec_precision_binary32(get_vprec_func_precision_mantissa(
-            function_parent->precision_binary32));
-        _set_vprec_range_binary32(get_vprec_func_precision_exponent(
-            function_parent->precision_binary32));
+        _vprec_set_func_precisions(function_parent->precision_binary64,
+                                   function_parent->precision_binary32);
       }
     }
   }
 
   // if output arguments are not in the structure
-  if (function_inst->output_arguments == NULL && nb_args > 0) {
-    function_inst->output_arguments =
+  if (__atomic_load_n(&function_inst->output_arguments, __ATOMIC_ACQUIRE) ==
+          NULL &&
+      nb_args > 0) {
+    _vprec_func_precision_t *output_arguments =
         malloc(sizeof(_vprec_func_precision_t) * nb_args);
-    function_inst->nb_output_args = nb_args;
 
     for (int i = 0; i < nb_args; i++) {
-      int type = va_arg(ap, int);
-      void *value = va_arg(ap, void *);
+      const int type = signature->args[i].type;
 
       if (type == FDOUBLE) {
-        function_inst->output_arguments[i] =
+        output_arguments[i] =
             set_vprec_func_precision(FDOUBLE, VPREC_RANGE_BINARY64_DEFAULT,
                                      VPREC_PRECISION_BINARY64_DEFAULT);
       } else if (type == FFLOAT) {
-        function_inst->output_arguments[i] =
+        output_arguments[i] =
             set_vprec_func_precision(FFLOAT, VPREC_RANGE_BINARY32_DEFAULT,
                                      VPREC_PRECISION_BINARY32_DEFAULT);
       }
     }
 
+    // publish the arguments, unless another thread did
+    _vprec_func_precision_t *expected = NULL;
+    if (__atomic_compare_exchange_n(&function_inst->output_arguments, &expected,
+                                    output_arguments, false, __ATOMIC_RELEASE,
+                                    __ATOMIC_RELAXED)) {
+      function_inst->nb_output_args = nb_args;
+    } else {
+      free(output_arguments);
+    }
+
     // round to default value is useless, so exit
     return;
   }
@@ -743,20 +814,21 @@ void _interflop_exit_function(interflop_function_stack_t *stack, void *context,
         (VPREC_INST_MODE == vprecinst_all ||
          VPREC_INST_MODE == vprecinst_arg)) {
       for (int i = 0; i < nb_args; i++) {
-        int type = va_arg(ap, int);
+        const int type = signature->args[i].type;
+        char *address = (char *)values + signature->args[i].offset;
 
         if (type == FDOUBLE) {
-          double *value = va_arg(ap, double *);
+          double *value = (double *)address;
           *value =
-              _vprec_round_binary64(*value, 0, context,
+              _vprec_round_binary64(*value, ((t_context *)context)->ftz,
                                     get_vprec_func_precision_exponent(
                                         function_inst->output_arguments[i]),
                                     get_vprec_func_precision_mantissa(
                                         function_inst->output_arguments[i]));
         } else if (type == FFLOAT) {
-          float *value = va_arg(ap, float *);
+          float *value = (float *)address;
           *value =
-              _vprec_round_binary32(*value, 0, context,
+              _vprec_round_binary32(*value, ((t_context *)context)->ftz,
                                     get_vprec_func_precision_exponent(
                                         function_inst->output_arguments[i]),
                                     get_vprec_func_precision_mantissa(
@@ -773,41 +845,71 @@ void _interflop_exit_function(interflop_function_stack_t *stack, void *context,
  * point operators
  **********************************************************************/
 
-static void _interflop_add_float(float a, float b, float *c, void *context) {
-  *c = _vprec_binary32_binary_op(a, b, vprec_add, context);
-}
-
-static void _interflop_sub_float(float a, float b, float *c, void *context) {
-  *c = _vprec_binary32_binary_op(a, b, vprec_sub, context);
-}
-
-static void _interflop_mul_float(float a, float b, float *c, void *context) {
-  *c = _vprec_binary32_binary_op(a, b, vprec_mul, context);
-}
-
-static void _interflop_div_float(float a, float b, float *c, void *context) {
-  *c = _vprec_binary32_binary_op(a, b, vprec_div, context);
-}
-
-static void _interflop_add_double(double a, double b, double *c,
-                                  void *context) {
-  *c = _vprec_binary64_binary_op(a, b, vprec_add, context);
-}
-
-static void _interflop_sub_double(double a, double b, double *c,
-                                  void *context) {
-  *c = _vprec_binary64_binary_op(a, b, vprec_sub, context);
-}
+/* Defines the scalar and vector hooks of OPERATION on TYPE for the mode */
+/* MODE, with denormals-are-zero if DAZ and flush-to-zero if FTZ */
+#define DEFINE_VPREC_HOOK(OPERATION, TYPE, BINARYN, MODE, DAZ, FTZ)            \
+  static void _interflop_##OPERATION##_##TYPE##_##MODE##_##DAZ##_##FTZ(        \
+      TYPE a, TYPE b, TYPE *c, void *context __attribute__((unused))) {        \
+    *c = _vprec_##BINARYN##_binary_op(a, b, vprec_##OPERATION,                 \
+                                      vprecmode_##MODE, DAZ, FTZ);             \
+  }                                                                            \
+                                                                               \
+  static void _interflop_##OPERATION##_##TYPE##_vec_##MODE##_##DAZ##_##FTZ(    \
+      int width, const TYPE *a, const TYPE *b, TYPE *c,                        \
+      void *context __attribute__((unused))) {                                 \
+    for (int i = 0; i < width; i++)                                            \
+      c[i] = _vprec_##BINARYN##_binary_op(a[i], b[i], vprec_##OPERATION,       \
+                                          vprecmode_##MODE, DAZ, FTZ);         \
+  }
 
-static void _interflop_mul_double(double a, double b, double *c,
-                                  void *context) {
-  *c = _vprec_binary64_binary_op(a, b, vprec_mul, context);
-}
+#define DEFINE_VPREC_HOOKS(MODE, DAZ, FTZ)                                     \
+  DEFINE_VPREC_HOOK(add, float, binary32, MODE, DAZ, FTZ)                      \
+  DEFINE_VPREC_HOOK(sub, float, binary32, MODE, DAZ, FTZ)                      \
+  DEFINE_VPREC_HOOK(mul, float, binary32, MODE, DAZ, FTZ)                      \
+  DEFINE_VPREC_HOOK(div, float, binary32, MODE, DAZ, FTZ)                      \
+  DEFINE_VPREC_HOOK(add, double, binary64, MODE, DAZ, FTZ)                     \
+  DEFINE_VPREC_HOOK(sub, double, binary64, MODE, DAZ, FTZ)                     \
+  DEFINE_VPREC_HOOK(mul, double, binary64, MODE, DAZ, FTZ)                     \
+  DEFINE_VPREC_HOOK(div, double, binary64, MODE, DAZ, FTZ)
+
+#define DEFINE_VPREC_MODE_HOOKS(MODE)                                          \
+  DEFINE_VPREC_HOOKS(MODE, 0, 0)                                               \
+  DEFINE_VPREC_HOOKS(MODE, 0, 1)                                               \
+  DEFINE_VPREC_HOOKS(MODE, 1, 0)                                               \
+  DEFINE_VPREC_HOOKS(MODE, 1, 1)
+
+DEFINE_VPREC_MODE_HOOKS(ieee)
+DEFINE_VPREC_MODE_HOOKS(full)
+DEFINE_VPREC_MODE_HOOKS(ib)
+DEFINE_VPREC_MODE_HOOKS(ob)
+
+/* Interface of the hooks specialized for MODE, DAZ and FTZ */
+#define VPREC_BACKEND(MODE, DAZ, FTZ)                                          \
+  {                                                                            \
+    _interflop_add_float_##MODE##_##DAZ##_##FTZ,                               \
+        _interflop_sub_float_##MODE##_##DAZ##_##FTZ,                           \
+        _interflop_mul_float_##MODE##_##DAZ##_##FTZ,                           \
+        _interflop_div_float_##MODE##_##DAZ##_##FTZ, NULL,                     \
+        _interflop_add_double_##MODE##_##DAZ##_##FTZ,                          \
+        _interflop_sub_double_##MODE##_##DAZ##_##FTZ,                          \
+        _interflop_mul_double_##MODE##_##DAZ##_##FTZ,                          \
+        _interflop_div_double_##MODE##_##DAZ##_##FTZ, NULL,                    \
+        _interflop_enter_function, _interflop_exit_function,                   \
+        _interflop_finalize, _interflop_add_float_vec_##MODE##_##DAZ##_##FTZ,  \
+        _interflop_sub_float_vec_##MODE##_##DAZ##_##FTZ,                       \
+        _interflop_mul_float_vec_##MODE##_##DAZ##_##FTZ,                       \
+        _interflop_div_float_vec_##MODE##_##DAZ##_##FTZ,                       \
+        _interflop_add_double_vec_##MODE##_##DAZ##_##FTZ,                      \
+        _interflop_sub_double_vec_##MODE##_##DAZ##_##FTZ,                      \
+        _interflop_mul_double_vec_##MODE##_##DAZ##_##FTZ,                      \
+        _interflop_div_double_vec_##MODE##_##DAZ##_##FTZ                       \
+  }
 
-static void _interflop_div_double(double a, double b, double *c,
-                                  void *context) {
-  *c = _vprec_binary64_binary_op(a, b, vprec_div, context);
-}
+#define VPREC_MODE_BACKENDS(MODE)                                              \
+  {                                                                            \
+    {VPREC_BACKEND(MODE, 0, 0), VPREC_BACKEND(MODE, 0, 1)},                    \
+        {VPREC_BACKEND(MODE, 1, 0), VPREC_BACKEND(MODE, 1, 1)},                \
+  }
 
 static struct argp_option options[] = {
     /* --debug, sets the variable debug = true */
@@ -1000,6 +1102,11 @@ void print_information_header(void *context) {
 }
 
 void _interflop_finalize(void *context) {
+  /* the map was already saved and freed by another instrumented module */
+  if (_vprec_func_map == NULL) {
+    return;
+  }
+
   /* save the hashmap */
   if (vprec_output_file != NULL) {
     FILE *f = fopen(vprec_output_file, "w");
@@ -1011,10 +1118,11 @@ void _interflop_finalize(void *context) {
     }
   }
   /* free vprec_function_map */
-  vfc_hashmap_free(_vprec_func_map);
+  vfc_concurrent_map_free(_vprec_func_map);
 
   /* destroy vprec_function_map */
-  vfc_hashmap_destroy(_vprec_func_map);
+  vfc_concurrent_map_destroy(_vprec_func_map);
+  _vprec_func_map = NULL;
 }
 
 struct interflop_backend_interface_t interflop_init(int argc, char **argv,
@@ -1023,8 +1131,11 @@ struct interflop_backend_interface_t interflop_init(int argc, char **argv,
   /* Initialize the logger */
   logger_init();
 
-  /* Initialize the vprec_function_map */
-  _vprec_func_map = vfc_hashmap_create();
+  /* Initialize the vprec_function_map, shared by the instrumented modules
+   * loading the backend */
+  if (_vprec_func_map == NULL) {
+    _vprec_func_map = vfc_concurrent_map_create();
+  }
 
   /* Setting to default values */
   _set_vprec_precision_binary32(VPREC_PRECISION_BINARY32_DEFAULT);
@@ -1042,6 +1153,12 @@ struct interflop_backend_interface_t interflop_init(int argc, char **argv,
 
   print_information_header(ctx);
 
+  /* precisions restored when leaving the outermost instrumented function */
+  _vprec_options_binary64 = set_vprec_func_precision(
+      FDOUBLE, VPRECLIB_BINARY64_RANGE, VPRECLIB_BINARY64_PRECISION);
+  _vprec_options_binary32 = set_vprec_func_precision(
+      FFLOAT, VPRECLIB_BINARY32_RANGE, VPRECLIB_BINARY32_PRECISION);
+
   /* read the hashmap */
   if (vprec_input_file != NULL) {
     FILE *f = fopen(vprec_input_file, "r");
@@ -1053,20 +1170,17 @@ struct interflop_backend_interface_t interflop_init(int argc, char **argv,
     }
   }
 
-  struct interflop_backend_interface_t interflop_backend_vprec = {
-      _interflop_add_float,
-      _interflop_sub_float,
-      _interflop_mul_float,
-      _interflop_div_float,
-      NULL,
-      _interflop_add_double,
-      _interflop_sub_double,
-      _interflop_mul_double,
-      _interflop_div_double,
-      NULL,
-      _interflop_enter_function,
-      _interflop_exit_function,
-      _interflop_finalize};
+  /* The hooks are specialized at compile time for each mode, daz and */
+  /* ftz combination, select the ones matching the options */
+  static const struct interflop_backend_interface_t
+      vprec_backends[_vprecmode_end_][2][2] = {
+          [vprecmode_ieee] = VPREC_MODE_BACKENDS(ieee),
+          [vprecmode_full] = VPREC_MODE_BACKENDS(full),
+          [vprecmode_ib] = VPREC_MODE_BACKENDS(ib),
+          [vprecmode_ob] = VPREC_MODE_BACKENDS(ob)};
+
+  struct interflop_backend_interface_t interflop_backend_vprec =
+      vprec_backends[VPRECLIB_MODE][ctx->daz][ctx->ftz];
 
   return interflop_backend_vprec;
 }
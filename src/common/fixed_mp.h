@@ -0,0 +1,424 @@
+/*****************************************************************************
+ *                                                                           *
+ *  This file is part of Verificarlo.                                        *
+ *                                                                           *
+ *  Copyright (c) 2020                                                       *
+ *     Verificarlo contributors                                              *
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *
+ *                                                                           *
+ *  Verificarlo is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by     *
+ *  the Free Software Foundation, either version 3 of the License, or        *
+ *  (at your option) any later version.                                      *
+ *                                                                           *
+ *  Verificarlo is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *  GNU General Public License for more details.                             *
+ *                                                                           *
+ *  You should have received a copy of the GNU General Public License        *
+ *  along with Verificarlo.  If not, see <http://www.gnu.org/licenses/>.     *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef __FIXED_MP_H__
+#define __FIXED_MP_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "float_const.h"
+#include "float_struct.h"
+
+/* Floating-point numbers with a significand of n = 2, 3 or 4 limbs of */
+/* 64 bits, that is a precision of 64 * n bits. Every operation is */
+/* correctly rounded to nearest even, like MPFR with MPFR_RNDN at the */
+/* same precision. */
+/* A nonzero x is (-1)^sign * m * 2^(exp - (64 * n - 1)) where the */
+/* n-limb integer m, least significant limb first, has its top bit set, */
+/* so that |x| is in [2^exp, 2^(exp + 1)). Zero has m = 0. */
+/* The exponent is a 32 bits integer that cannot overflow for operations */
+/* on binary64 values, special values are left to the callers. */
+/* The limb count n is an argument of every function, it becomes a */
+/* compile-time constant once the functions are inlined in the callers. */
+
+#define FMP_LIMBS_MAX 4
+
+typedef struct {
+  uint64_t m[FMP_LIMBS_MAX];
+  int32_t exp;
+  bool sign;
+} fixed_mp;
+
+#define FMP_LIMB_MSB (UINT64_C(1) << 63)
+
+/* Returns true if x is zero */
+static inline bool _fmp_is_zero(const fixed_mp *x, const int n) {
+  return x->m[n - 1] == 0;
+}
+
+/* Sets x to zero with the given sign */
+static inline void _fmp_set_zero(fixed_mp *x, const bool sign, const int n) {
+  for (int i = 0; i < n; i++) {
+    x->m[i] = 0;
+  }
+  x->exp = 0;
+  x->sign = sign;
+}
+
+/* Returns the number of leading zeros of the len-limb integer r */
+static inline int _fmp_clz(const uint64_t *r, const int len) {
+  for (int i = len - 1; i >= 0; i--) {
+    if (r[i] != 0) {
+      return 64 * (len - 1 - i) + __builtin_clzll(r[i]);
+    }
+  }
+  return 64 * len;
+}
+
+/* Shifts the len-limb integer r left by s < 64 * len bits */
+static inline void _fmp_shift_left(uint64_t *r, const int len, const int s) {
+  const int q = s / 64;
+  const int b = s % 64;
+  for (int i = len - 1; i >= 0; i--) {
+    const uint64_t hi = (i - q >= 0) ? r[i - q] : 0;
+    const uint64_t lo = (i - q - 1 >= 0) ? r[i - q - 1] : 0;
+    r[i] = (b == 0) ? hi : (hi << b) | (lo >> (64 - b));
+  }
+}
+
+/* Shifts the len-limb integer r right by s bits, the lowest bit is set */
+/* if any of the shifted out bits is set */
+static inline void _fmp_shift_right_sticky(uint64_t *r, const int len,
+                                           const int s) {
+  if (s == 0) {
+    return;
+  }
+  uint64_t sticky = 0;
+  if (s >= 64 * len) {
+    for (int i = 0; i < len; i++) {
+      sticky |= r[i];
+      r[i] = 0;
+    }
+    r[0] = (sticky != 0);
+    return;
+  }
+  const int q = s / 64;
+  const int b = s % 64;
+  for (int i = 0; i < q; i++) {
+    sticky |= r[i];
+  }
+  if (b != 0) {
+    sticky |= r[q] << (64 - b);
+  }
+  for (int i = 0; i < len; i++) {
+    const uint64_t lo = (i + q < len) ? r[i + q] : 0;
+    const uint64_t hi = (i + q + 1 < len) ? r[i + q + 1] : 0;
+    r[i] = (b == 0) ? lo : (lo >> b) | (hi << (64 - b));
+  }
+  r[0] |= (sticky != 0);
+}
+
+/* Rounds to nearest even the normalized (n + 1)-limb significand r into */
+/* the significand of x. The lowest limb of r holds the bits below the */
+/* precision, with a sticky bit in its lowest bit when the result is */
+/* inexact. x->exp must be set and is incremented if the rounding carries */
+static inline void _fmp_round(fixed_mp *x, const uint64_t *r, const int n) {
+  const bool up = r[0] > FMP_LIMB_MSB || (r[0] == FMP_LIMB_MSB && (r[1] & 1));
+  uint64_t carry = up;
+  for (int i = 0; i < n; i++) {
+    x->m[i] = r[i + 1] + carry;
+    carry = carry && x->m[i] == 0;
+  }
+  if (carry) {
+    x->m[n - 1] = FMP_LIMB_MSB;
+    x->exp++;
+  }
+}
+
+/* Sets x to the finite binary64 a */
+static inline void _fmp_set_d(fixed_mp *x, const double a, const int n) {
+  const binary64 b64 = {.f64 = a};
+  const int32_t biased_exp = (b64.u64 & DOUBLE_GET_EXP) >> DOUBLE_PMAN_SIZE;
+  uint64_t m = b64.u64 & DOUBLE_GET_PMAN;
+  _fmp_set_zero(x, (b64.u64 & DOUBLE_GET_SIGN) != 0, n);
+  if (biased_exp != 0) {
+    m |= UINT64_C(1) << DOUBLE_PMAN_SIZE;
+    x->exp = biased_exp - DOUBLE_EXP_COMP;
+  } else if (m != 0) {
+    /* subnormal, the leading bit is below the implicit bit position */
+    const int shift = __builtin_clzll(m) - (63 - DOUBLE_PMAN_SIZE);
+    x->exp = -DOUBLE_EXP_MIN - shift;
+  } else {
+    return;
+  }
+  x->m[n - 1] = m << __builtin_clzll(m);
+}
+
+/* Sets x to k * 2^exp for a nonzero k */
+static inline void _fmp_set_si_2exp(fixed_mp *x, const int64_t k,
+                                    const int32_t exp, const int n) {
+  const uint64_t m = (k < 0) ? -(uint64_t)k : (uint64_t)k;
+  const int s = __builtin_clzll(m);
+  _fmp_set_zero(x, k < 0, n);
+  x->exp = exp + 63 - s;
+  x->m[n - 1] = m << s;
+}
+
+/* Returns x rounded to the nearest binary64, with gradual underflow */
+/* and overflow to infinity */
+static inline double _fmp_get_d(const fixed_mp *x, const int n) {
+  binary64 b64 = {.u64 = x->sign ? DOUBLE_GET_SIGN : 0};
+  if (_fmp_is_zero(x, n)) {
+    return b64.f64;
+  }
+  if (x->exp > DOUBLE_NORMAL_EXP_MAX) {
+    b64.u64 |= DOUBLE_PLUS_INF;
+    return b64.f64;
+  }
+  /* number of bits kept, less than 53 for subnormal results */
+  int bits = DOUBLE_PREC;
+  if (x->exp < -DOUBLE_EXP_MIN) {
+    bits -= -DOUBLE_EXP_MIN - x->exp;
+  }
+  if (bits < 0) {
+    return b64.f64;
+  }
+  bool sticky = false;
+  for (int i = 0; i < n - 1; i++) {
+    sticky |= x->m[i] != 0;
+  }
+  const uint64_t top = x->m[n - 1];
+  uint64_t q = (bits == 0) ? 0 : top >> (64 - bits);
+  const uint64_t rem = top << bits;
+  if (rem > FMP_LIMB_MSB || (rem == FMP_LIMB_MSB && (sticky || (q & 1)))) {
+    q++;
+  }
+  /* q includes the implicit bit, so that a carry of the rounding */
+  /* propagates to the exponent field and possibly to infinity */
+  if (x->exp >= -DOUBLE_EXP_MIN) {
+    const uint64_t biased_exp = x->exp + DOUBLE_EXP_COMP - 1;
+    b64.u64 |= (biased_exp << DOUBLE_PMAN_SIZE) + q;
+  } else {
+    b64.u64 |= q;
+  }
+  return b64.f64;
+}
+
+/* Returns the number of bits needed to represent the nonzero x */
+static inline int _fmp_min_prec(const fixed_mp *x, const int n) {
+  for (int i = 0; i < n; i++) {
+    if (x->m[i] != 0) {
+      return 64 * (n - i) - __builtin_ctzll(x->m[i]);
+    }
+  }
+  return 0;
+}
+
+/* Compares the absolute values of the nonzero a and b */
+static inline int _fmp_cmp_abs(const fixed_mp *a, const fixed_mp *b,
+                               const int n) {
+  if (a->exp != b->exp) {
+    return (a->exp > b->exp) ? 1 : -1;
+  }
+  for (int i = n - 1; i >= 0; i--) {
+    if (a->m[i] != b->m[i]) {
+      return (a->m[i] > b->m[i]) ? 1 : -1;
+    }
+  }
+  return 0;
+}
+
+/* Sets r to a + b */
+/* The smaller operand is aligned on n + 1 limbs, the bits shifted out */
+/* are kept as a sticky bit which is enough to round correctly since */
+/* the extra limb has more than two bits */
+static inline void _fmp_add(fixed_mp *r, const fixed_mp *a, const fixed_mp *b,
+                            const int n) {
+  if (_fmp_is_zero(a, n) && _fmp_is_zero(b, n)) {
+    _fmp_set_zero(r, a->sign && b->sign, n);
+    return;
+  } else if (_fmp_is_zero(b, n)) {
+    *r = *a;
+    return;
+  } else if (_fmp_is_zero(a, n)) {
+    *r = *b;
+    return;
+  }
+
+  const int cmp = _fmp_cmp_abs(a, b, n);
+  if (cmp == 0 && a->sign != b->sign) {
+    _fmp_set_zero(r, false, n);
+    return;
+  }
+  const fixed_mp *x = (cmp > 0) ? a : b;
+  const fixed_mp *y = (cmp > 0) ? b : a;
+
+  uint64_t rx[FMP_LIMBS_MAX + 1] = {0};
+  uint64_t ry[FMP_LIMBS_MAX + 1] = {0};
+  for (int i = 0; i < n; i++) {
+    rx[i + 1] = x->m[i];
+    ry[i + 1] = y->m[i];
+  }
+  const int64_t shift = (int64_t)x->exp - y->exp;
+  _fmp_shift_right_sticky(ry, n + 1,
+                          (shift > 64 * (n + 1)) ? 64 * (n + 1) : shift);
+
+  const bool sign = x->sign;
+  int32_t exp = x->exp;
+  if (x->sign == y->sign) {
+    unsigned __int128 carry = 0;
+    for (int i = 0; i <= n; i++) {
+      carry += (unsigned __int128)rx[i] + ry[i];
+      rx[i] = (uint64_t)carry;
+      carry >>= 64;
+    }
+    if (carry) {
+      _fmp_shift_right_sticky(rx, n + 1, 1);
+      rx[n] |= FMP_LIMB_MSB;
+      exp++;
+    }
+  } else {
+    uint64_t borrow = 0;
+    for (int i = 0; i <= n; i++) {
+      const uint64_t d = rx[i] - ry[i];
+      const uint64_t next_borrow = (rx[i] < ry[i]) || (d < borrow);
+      rx[i] = d - borrow;
+      borrow = next_borrow;
+    }
+    /* the cancellation is exact when the shift is at most one bit */
+    const int s = _fmp_clz(rx, n + 1);
+    _fmp_shift_left(rx, n + 1, s);
+    exp -= s;
+  }
+  r->sign = sign;
+  r->exp = exp;
+  _fmp_round(r, rx, n);
+}
+
+/* Sets r to a - b */
+static inline void _fmp_sub(fixed_mp *r, const fixed_mp *a, const fixed_mp *b,
+                            const int n) {
+  fixed_mp neg_b = *b;
+  neg_b.sign = !b->sign;
+  _fmp_add(r, a, &neg_b, n);
+}
+
+/* Sets r to a * b */
+/* The 2n-limb product is exact and rounded with its lower limbs */
+/* collapsed into a sticky bit */
+static inline void _fmp_mul(fixed_mp *r, const fixed_mp *a, const fixed_mp *b,
+                            const int n) {
+  const bool sign = a->sign != b->sign;
+  if (_fmp_is_zero(a, n) || _fmp_is_zero(b, n)) {
+    _fmp_set_zero(r, sign, n);
+    return;
+  }
+
+  uint64_t p[2 * FMP_LIMBS_MAX] = {0};
+  for (int i = 0; i < n; i++) {
+    unsigned __int128 carry = 0;
+    for (int j = 0; j < n; j++) {
+      carry += (unsigned __int128)a->m[i] * b->m[j] + p[i + j];
+      p[i + j] = (uint64_t)carry;
+      carry >>= 64;
+    }
+    p[i + n] = (uint64_t)carry;
+  }
+
+  /* the product of the significands is in [2^(128n-2), 2^(128n)) */
+  int32_t exp = a->exp + b->exp;
+  if (p[2 * n - 1] & FMP_LIMB_MSB) {
+    exp++;
+  } else {
+    _fmp_shift_left(p, 2 * n, 1);
+  }
+  for (int i = 0; i < n - 1; i++) {
+    p[n - 1] |= (p[i] != 0);
+  }
+  r->sign = sign;
+  r->exp = exp;
+  _fmp_round(r, p + n - 1, n);
+}
+
+/* Sets r to a / b for a nonzero b */
+/* The quotient is computed on n + 1 limbs with the schoolbook division */
+/* (Knuth, TAOCP vol. 2, algorithm D) and the remainder gives the sticky */
+/* bit. The significand of b is already normalized. */
+static inline void _fmp_div(fixed_mp *r, const fixed_mp *a, const fixed_mp *b,
+                            const int n) {
+  const bool sign = a->sign != b->sign;
+  if (_fmp_is_zero(a, n)) {
+    _fmp_set_zero(r, sign, n);
+    return;
+  }
+
+  /* u = m_a * 2^(64(n+1)) on 2n + 1 limbs, plus the extra top limb */
+  /* used by the algorithm */
+  uint64_t u[2 * FMP_LIMBS_MAX + 2] = {0};
+  uint64_t q[FMP_LIMBS_MAX + 2] = {0};
+  const uint64_t *v = b->m;
+  for (int i = 0; i < n; i++) {
+    u[n + 1 + i] = a->m[i];
+  }
+
+  for (int j = n + 1; j >= 0; j--) {
+    const unsigned __int128 num =
+        ((unsigned __int128)u[j + n] << 64) | u[j + n - 1];
+    unsigned __int128 qhat = num / v[n - 1];
+    unsigned __int128 rhat = num % v[n - 1];
+    while ((qhat >> 64) != 0 ||
+           qhat * v[n - 2] > ((rhat << 64) | u[j + n - 2])) {
+      qhat--;
+      rhat += v[n - 1];
+      if ((rhat >> 64) != 0) {
+        break;
+      }
+    }
+
+    /* u[j..j+n] -= qhat * v */
+    unsigned __int128 carry = 0;
+    uint64_t borrow = 0;
+    for (int i = 0; i < n; i++) {
+      carry += qhat * v[i];
+      const uint64_t prod = (uint64_t)carry;
+      carry >>= 64;
+      const uint64_t d = u[i + j] - prod;
+      const uint64_t next_borrow = (u[i + j] < prod) || (d < borrow);
+      u[i + j] = d - borrow;
+      borrow = next_borrow;
+    }
+    const uint64_t prod = (uint64_t)carry;
+    const bool negative = (u[j + n] < prod) || (u[j + n] - prod < borrow);
+    u[j + n] = u[j + n] - prod - borrow;
+
+    /* qhat was one too large, add v back */
+    if (negative) {
+      qhat--;
+      carry = 0;
+      for (int i = 0; i < n; i++) {
+        carry += (unsigned __int128)u[i + j] + v[i];
+        u[i + j] = (uint64_t)carry;
+        carry >>= 64;
+      }
+      u[j + n] += (uint64_t)carry;
+    }
+    q[j] = (uint64_t)qhat;
+  }
+
+  /* m_a / m_b is in (1/2, 2) so the quotient has n + 1 or n + 2 limbs */
+  int32_t exp = a->exp - b->exp;
+  if (q[n + 1] != 0) {
+    _fmp_shift_right_sticky(q, n + 2, 1);
+  } else {
+    exp--;
+  }
+  for (int i = 0; i < n; i++) {
+    q[0] |= (u[i] != 0);
+  }
+  r->sign = sign;
+  r->exp = exp;
+  _fmp_round(r, q, n);
+}
+
+#endif /* __FIXED_MP_H__ */
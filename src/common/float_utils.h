@@ -187,4 +187,91 @@ static inline __float128 _fast_pow2_binary128(const int exp) {
            : _get_exponent_binary64, __float128                                \
            : _get_exponent_binary128)(X)
 
+/* Error-free transformations: the rounding error of a binary64 addition */
+/* or multiplication is itself a binary64, as long as no overflow or */
+/* underflow occurs */
+
+/* Unevaluated sum hi + lo of two binary64 */
+typedef struct {
+  double hi;
+  double lo;
+} double_double;
+
+/* Returns s such that s.hi + s.lo = a + b exactly */
+static inline double_double _dd_two_sum(const double a, const double b) {
+  const double s = a + b;
+  const double bb = s - a;
+  const double e = (a - (s - bb)) + (b - bb);
+  return (double_double){s, e};
+}
+
+/* Same as _dd_two_sum when |a| >= |b| */
+static inline double_double _dd_fast_two_sum(const double a, const double b) {
+  const double s = a + b;
+  return (double_double){s, b - (s - a)};
+}
+
+/* Returns p such that p.hi + p.lo = a * b exactly */
+static inline double_double _dd_two_prod(const double a, const double b) {
+  const double p = a * b;
+#if defined(__FMA__)
+  return (double_double){p, __builtin_fma(a, b, -p)};
+#else
+  /* Dekker's product with Veltkamp's splitting by 2^27 + 1 */
+  const double ca = 134217729.0 * a;
+  const double cb = 134217729.0 * b;
+  const double a_hi = ca - (ca - a), a_lo = a - a_hi;
+  const double b_hi = cb - (cb - b), b_lo = b - b_hi;
+  return (double_double){
+      p, ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo};
+#endif
+}
+
+/* MCA noise built from random bits without multiplication */
+/* For the 64 random bits r, the uniform number u in (0, 1) drawn by */
+/* tinymt64_uint64_to_doubleOO is d - 1 where d in [1, 2) has the */
+/* mantissa (r >> 12) | 1. The noise (u - 0.5) * 2^exp is thus */
+/* (d - 1.5) * 2^exp: d - 1.5 is exact (Sterbenz) and never zero since */
+/* the last mantissa bit of d is set, and the scaling by 2^exp is an */
+/* integer addition to its exponent field. */
+
+/* Returns the binary64 encoding of u - 0.5 for the random bits r */
+static inline uint64_t _noise_bits(const uint64_t r) {
+  binary64 d = {.u64 = (r >> 12) | UINT64_C(0x3ff0000000000001)};
+  d.f64 -= 1.5;
+  return d.u64;
+}
+
+/* Returns the integer k such that u - 0.5 = k * 2^-52 for the random */
+/* bits r, where |k| < 2^51 and k is odd */
+static inline int64_t _noise_integer(const uint64_t r) {
+  return (int64_t)((r >> 12) | 1) - (INT64_C(1) << (DOUBLE_PMAN_SIZE - 1));
+}
+
+/* Returns (u - 0.5) * 2^exp as a binary64 for the random bits r */
+/* The result must be normal, exp >= -DOUBLE_EXP_MIN + DOUBLE_PMAN_SIZE */
+static inline double _noise_from_bits_binary64(const uint64_t r,
+                                               const int32_t exp) {
+  binary64 b64 = {.u64 = _noise_bits(r)};
+  b64.u64 += (uint64_t)(int64_t)exp << DOUBLE_PMAN_SIZE;
+  return b64.f64;
+}
+
+/* Returns (u - 0.5) * 2^exp as a binary128 for the random bits r */
+/* The binary64 noise is widened with integer operations, the result */
+/* must be normal, exp >= -QUAD_EXP_MIN + DOUBLE_PMAN_SIZE */
+static inline __float128 _noise_from_bits_binary128(const uint64_t r,
+                                                    const int32_t exp) {
+  const uint64_t n = _noise_bits(r);
+  const uint64_t sign = n & DOUBLE_GET_SIGN;
+  const uint64_t biased_exp = ((n & DOUBLE_GET_EXP) >> DOUBLE_PMAN_SIZE) -
+                              DOUBLE_EXP_COMP + QUAD_EXP_COMP + exp;
+  const uint64_t pman = n & DOUBLE_GET_PMAN;
+  binary128 b128;
+  b128.words64.high = sign | (biased_exp << QUAD_HX_PMAN_SIZE) |
+                      (pman >> (DOUBLE_PMAN_SIZE - QUAD_HX_PMAN_SIZE));
+  b128.words64.low = pman << (64 - (DOUBLE_PMAN_SIZE - QUAD_HX_PMAN_SIZE));
+  return b128.f128;
+}
+
 #endif /* __FLOAT_UTILS_H__ */
@@ -35,9 +35,34 @@ typedef struct interflop_function_info {
   short useFloat;
   // Indicate if the function use float
   short useDouble;
+  // Data of the backend instrumenting the functions for this call site, NULL
+  // until the backend sets it. Each call site has its own descriptor, also
+  // when several instrumented modules share the backend.
+  void *backend_data;
 } interflop_function_info_t;
 
-/* Verificarlo call stack */
+/* Type and position of a floating point argument or return value in the
+ * structure passed to the function hooks */
+typedef struct interflop_function_arg {
+  // Type of the value, in enum FTYPES
+  unsigned short type;
+  // Offset of the value in bytes from the start of the structure
+  unsigned short offset;
+} interflop_function_arg_t;
+
+/* Signature of the floating point arguments, or of the return value, of an
+ * instrumented call site. It is a constant emitted by the function
+ * instrumentation pass, the values are stored in a structure laid out
+ * accordingly. */
+typedef struct interflop_function_signature {
+  // Number of floating point values
+  unsigned int nb_args;
+  interflop_function_arg_t args[];
+} interflop_function_signature_t;
+
+/* Verificarlo call stack of the calling thread: array[top] is the called
+ * function, array[top + 1] its caller, NULL at the bottom of the stack. The
+ * array may move between two calls to the hooks. */
 typedef struct interflop_function_stack {
   interflop_function_info_t **array;
   long int top;
@@ -58,15 +83,39 @@ struct interflop_backend_interface_t {
   void (*interflop_cmp_double)(enum FCMP_PREDICATE p, double a, double b,
                                int *c, void *context);
 
-  void (*interflop_enter_function)(interflop_function_stack_t *stack,
-                                   void *context, int nb_args, va_list ap);
+  void (*interflop_enter_function)(
+      interflop_function_stack_t *stack, void *context,
+      const interflop_function_signature_t *signature, void *values);
 
-  void (*interflop_exit_function)(interflop_function_stack_t *stack,
-                                  void *context, int nb_args, va_list ap);
+  void (*interflop_exit_function)(
+      interflop_function_stack_t *stack, void *context,
+      const interflop_function_signature_t *signature, void *values);
 
   /* interflop_finalize: called at the end of the instrumented program
    * execution */
   void (*interflop_finalize)(void *context);
+
+  /* Vector hooks: c[i] = a[i] op b[i] for i < width.
+   * A backend may set them to NULL, the frontend then calls the scalar hook
+   * on each element. They are part of the returned structure, so backends
+   * built against a header without them must be rebuilt. */
+  void (*interflop_add_float_vec)(int width, const float *a, const float *b,
+                                  float *c, void *context);
+  void (*interflop_sub_float_vec)(int width, const float *a, const float *b,
+                                  float *c, void *context);
+  void (*interflop_mul_float_vec)(int width, const float *a, const float *b,
+                                  float *c, void *context);
+  void (*interflop_div_float_vec)(int width, const float *a, const float *b,
+                                  float *c, void *context);
+
+  void (*interflop_add_double_vec)(int width, const double *a,
+                                   const double *b, double *c, void *context);
+  void (*interflop_sub_double_vec)(int width, const double *a,
+                                   const double *b, double *c, void *context);
+  void (*interflop_mul_double_vec)(int width, const double *a,
+                                   const double *b, double *c, void *context);
+  void (*interflop_div_double_vec)(int width, const double *a,
+                                   const double *b, double *c, void *context);
 };
 
 /* interflop_init: called at initialization before using a backend.
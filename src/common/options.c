@@ -24,21 +24,62 @@
  *                                                                           *
  *****************************************************************************/
 
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <strings.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "options.h"
 #include "tinymt64.h"
 
+const char *RNG_KIND_STR[] = {"tinymt64", "philox"};
+
+bool _parse_rng_kind(const char *arg, rng_kind_t *kind) {
+  for (int k = 0; k < _rng_end_; k++) {
+    if (strcasecmp(RNG_KIND_STR[k], arg) == 0) {
+      *kind = k;
+      return true;
+    }
+  }
+  return false;
+}
+
+/* OpenMP thread numbers are used when the runtime is loaded */
+extern int omp_get_level(void) __attribute__((weak));
+extern int omp_get_thread_num(void) __attribute__((weak));
+
+uint64_t _get_thread_index(void) {
+  static uint64_t threads_count = 0;
+  /* index 0 is only given to the main thread of the process */
+  if (syscall(SYS_gettid) == getpid()) {
+    return 0;
+  }
+  /* the workers of an outermost parallel region, the master of the team may
+   * not be the main thread */
+  if (omp_get_level && omp_get_thread_num && omp_get_level() == 1 &&
+      omp_get_thread_num() != 0) {
+    return omp_get_thread_num();
+  }
+  const uint64_t n = __atomic_fetch_add(&threads_count, 1, __ATOMIC_RELAXED);
+  return (1ULL << 32) + n;
+}
+
 /* Generic set_seed function which is common for most of the backends */
-void _set_seed_default(tinymt64_t *random_state, const bool choose_seed,
-                       const uint64_t seed) {
+void _set_seed_thread(tinymt64_t *random_state, const bool choose_seed,
+                      const uint64_t seed, const uint64_t thread_index) {
   if (choose_seed) {
-    tinymt64_init(random_state, seed);
+    if (thread_index == 0) {
+      tinymt64_init(random_state, seed);
+    } else {
+      uint64_t init_key[] = {seed, thread_index};
+      tinymt64_init_by_array(random_state, init_key, 2);
+    }
   } else {
-    const int key_length = 3;
+    const int key_length = 4;
     uint64_t init_key[key_length];
     struct timeval t1;
     gettimeofday(&t1, NULL);
@@ -46,6 +87,39 @@ void _set_seed_default(tinymt64_t *random_state, const bool choose_seed,
     init_key[0] = t1.tv_sec;
     init_key[1] = t1.tv_usec;
     init_key[2] = getpid();
+    init_key[3] = thread_index;
     tinymt64_init_by_array(random_state, init_key, key_length);
   }
 }
+
+void _init_rng_state_thread(rng_state_t *rng_state,
+                            const rng_config_t *config) {
+  const uint64_t thread_index = _get_thread_index();
+  if (config->kind == rng_philox) {
+    /* the thread index selects the stream, the key is the seed */
+    uint64_t key = config->seed;
+    if (!config->choose_seed) {
+      struct timeval t1;
+      gettimeofday(&t1, NULL);
+      key = (t1.tv_sec * 1000000 + t1.tv_usec) ^ ((uint64_t)getpid() << 40);
+    }
+    philox_init(&rng_state->philox_state, key, thread_index);
+  } else {
+    _set_seed_thread(&rng_state->random_state, config->choose_seed,
+                     config->seed, thread_index);
+  }
+  rng_state->buffer_count = 0;
+  rng_state->initialized = true;
+}
+
+void _rng_fill_buffer(rng_state_t *rng_state, const rng_config_t *config) {
+  _init_rng_state(rng_state, config);
+  if (config->kind == rng_philox) {
+    philox_generate_uint64_n(&rng_state->philox_state, rng_state->buffer,
+                             RNG_BUFFER_SIZE);
+  } else {
+    tinymt64_generate_uint64_n(&rng_state->random_state, rng_state->buffer,
+                               RNG_BUFFER_SIZE);
+  }
+  rng_state->buffer_count = RNG_BUFFER_SIZE;
+}
@@ -27,8 +27,12 @@
 #ifndef __OPTIONS_H__
 #define __OPTIONS_H__
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "float_const.h"
 #include "logger.h"
+#include "philox.h"
 #include "tinymt64.h"
 
 /* Generic set_precision macro function which is common with most of the backend
@@ -59,8 +63,81 @@
     *T = PRECISION;                                                            \
   }
 
-/* Generic set_seed function which is common for most of the backends */
-void _set_seed_default(tinymt64_t *random_state, const bool choose_seed,
-                       const uint64_t seed);
+/* Random generators selectable with the --rng backend option */
+typedef enum { rng_tinymt64, rng_philox, _rng_end_ } rng_kind_t;
+
+extern const char *RNG_KIND_STR[];
+
+/* Parses the generator name arg into kind, returns false if unknown */
+bool _parse_rng_kind(const char *arg, rng_kind_t *kind);
+
+/* Random generator configuration shared by all the threads of a backend */
+typedef struct {
+  rng_kind_t kind;
+  bool choose_seed;
+  uint64_t seed;
+} rng_config_t;
+
+/* Number of values generated at once by the random generators */
+#define RNG_BUFFER_SIZE 64
+
+/* Per-thread random generator state. Backends keep one thread-local
+ * instance which is seeded on the first draw of each thread. Values are
+ * generated RNG_BUFFER_SIZE at a time in buffer and consumed in order, so
+ * the stream is the same as drawing them one by one. */
+typedef struct {
+  tinymt64_t random_state;
+  philox_t philox_state;
+  uint64_t buffer[RNG_BUFFER_SIZE];
+  /* number of values left in buffer */
+  uint32_t buffer_count;
+  bool initialized;
+} rng_state_t;
+
+/* Returns the index of the calling thread: 0 for the main thread, the OpenMP
+ * thread number for the other threads of an outermost parallel region and
+ * 2^32 + n for the n-th other thread calling it. The indices of the last
+ * threads, e.g. pthreads, depend on the order in which they first call it. */
+uint64_t _get_thread_index(void);
+
+/* Seeds the random state of the thread thread_index. When choose_seed is
+ * set the stream only depends on (seed, thread_index) and thread 0 gets
+ * the same stream as a single-threaded run. */
+void _set_seed_thread(tinymt64_t *random_state, const bool choose_seed,
+                      const uint64_t seed, const uint64_t thread_index);
+
+/* Seeds rng_state for the calling thread according to config */
+void _init_rng_state_thread(rng_state_t *rng_state,
+                            const rng_config_t *config);
+
+/* Seeds rng_state for the calling thread if it is not already done */
+static inline void _init_rng_state(rng_state_t *rng_state,
+                                   const rng_config_t *config) {
+  if (__builtin_expect(!rng_state->initialized, 0)) {
+    _init_rng_state_thread(rng_state, config);
+  }
+}
+
+/* Refills the buffer of rng_state with the generator selected by config,
+ * seeding it first if needed */
+void _rng_fill_buffer(rng_state_t *rng_state, const rng_config_t *config);
+
+/* Returns a random 64-bit unsigned integer. A zeroed state has an empty
+ * buffer, so the fast path needs a single test. */
+static inline uint64_t _rng_generate_uint64(rng_state_t *rng_state,
+                                            const rng_config_t *config) {
+  if (__builtin_expect(rng_state->buffer_count == 0, 0)) {
+    _rng_fill_buffer(rng_state, config);
+  }
+  return rng_state->buffer[RNG_BUFFER_SIZE - rng_state->buffer_count--];
+}
+
+/* Returns a random double in the (0,1) open interval. Both generators use
+ * the tinymt64 conversion, so tinymt64 gives the same values as
+ * tinymt64_generate_doubleOO. */
+static inline double _rng_generate_doubleOO(rng_state_t *rng_state,
+                                            const rng_config_t *config) {
+  return tinymt64_uint64_to_doubleOO(_rng_generate_uint64(rng_state, config));
+}
 
 #endif /* __OPTIONS_H__ */
@@ -0,0 +1,116 @@
+/*****************************************************************************
+ *                                                                           *
+ *  This file is part of Verificarlo.                                        *
+ *                                                                           *
+ *  Copyright (c) 2020                                                       *
+ *     Verificarlo contributors                                              *
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *
+ *                                                                           *
+ *  Verificarlo is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by     *
+ *  the Free Software Foundation, either version 3 of the License, or        *
+ *  (at your option) any later version.                                      *
+ *                                                                           *
+ *  Verificarlo is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *  GNU General Public License for more details.                             *
+ *                                                                           *
+ *  You should have received a copy of the GNU General Public License        *
+ *  along with Verificarlo.  If not, see <http://www.gnu.org/licenses/>.     *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef __PHILOX_H__
+#define __PHILOX_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Philox4x32-10 counter-based generator (Salmon et al., "Parallel random
+ * numbers: as easy as 1, 2, 3", SC'11). The n-th draw of a stream is a pure
+ * function of (key, stream, n): threads never share a state and the values
+ * do not depend on the interleaving of the threads. */
+
+#define PHILOX_M0 UINT32_C(0xD2511F53)
+#define PHILOX_M1 UINT32_C(0xCD9E8D57)
+#define PHILOX_W0 UINT32_C(0x9E3779B9)
+#define PHILOX_W1 UINT32_C(0xBB67AE85)
+#define PHILOX_ROUNDS 10
+
+typedef struct {
+  /* 64-bit key, usually the seed */
+  uint32_t key[2];
+  /* 64-bit stream identifier, usually the thread index */
+  uint32_t stream[2];
+  /* number of 64-bit values drawn so far */
+  uint64_t counter;
+} philox_t;
+
+static inline void philox_init(philox_t *philox, const uint64_t key,
+                               const uint64_t stream) {
+  philox->key[0] = (uint32_t)key;
+  philox->key[1] = (uint32_t)(key >> 32);
+  philox->stream[0] = (uint32_t)stream;
+  philox->stream[1] = (uint32_t)(stream >> 32);
+  philox->counter = 0;
+}
+
+/* Ten rounds of Philox4x32 applied to ctr under key */
+static inline void philox4x32_10(uint32_t ctr[4], const uint32_t key[2]) {
+  uint32_t k0 = key[0], k1 = key[1];
+  for (int r = 0; r < PHILOX_ROUNDS; r++) {
+    const uint64_t p0 = (uint64_t)PHILOX_M0 * ctr[0];
+    const uint64_t p1 = (uint64_t)PHILOX_M1 * ctr[2];
+    const uint32_t c0 = (uint32_t)(p1 >> 32) ^ ctr[1] ^ k0;
+    const uint32_t c2 = (uint32_t)(p0 >> 32) ^ ctr[3] ^ k1;
+    ctr[1] = (uint32_t)p1;
+    ctr[3] = (uint32_t)p0;
+    ctr[0] = c0;
+    ctr[2] = c2;
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+}
+
+/* Returns the two 64-bit values of block number block */
+static inline void philox_block(const philox_t *philox, const uint64_t block,
+                                uint64_t out[2]) {
+  uint32_t ctr[4] = {(uint32_t)block, (uint32_t)(block >> 32),
+                     philox->stream[0], philox->stream[1]};
+  philox4x32_10(ctr, philox->key);
+  out[0] = (uint64_t)ctr[1] << 32 | ctr[0];
+  out[1] = (uint64_t)ctr[3] << 32 | ctr[2];
+}
+
+/* Batch entry point: writes the next n values of the stream to out.
+ * Blocks are independent so the main loop vectorizes. */
+static inline void philox_generate_uint64_n(philox_t *philox, uint64_t *out,
+                                            size_t n) {
+  uint64_t block[2];
+  size_t i = 0;
+  /* odd counter, finish the current block */
+  if (n > 0 && (philox->counter & 1)) {
+    philox_block(philox, philox->counter >> 1, block);
+    out[i++] = block[1];
+  }
+  const uint64_t first = (philox->counter + i) >> 1;
+  const size_t blocks = (n - i) / 2;
+  for (size_t b = 0; b < blocks; b++) {
+    philox_block(philox, first + b, &out[i + 2 * b]);
+  }
+  i += 2 * blocks;
+  if (i < n) {
+    philox_block(philox, first + blocks, block);
+    out[i++] = block[0];
+  }
+  philox->counter += n;
+}
+
+static inline uint64_t philox_generate_uint64(philox_t *philox) {
+  uint64_t x;
+  philox_generate_uint64_n(philox, &x, 1);
+  return x;
+}
+
+#endif /* __PHILOX_H__ */
@@ -17,6 +17,7 @@
  */
 
 #include <inttypes.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #define TINYMT64_MEXP 127
@@ -211,6 +212,47 @@ inline static double tinymt64_generate_doubleOO(tinymt64_t *random) {
   return tinymt64_temper_conv_open(random) - 1.0;
 }
 
+/**
+ * This function fills out with the next n 64-bit unsigned integers, the
+ * same values as n calls to tinymt64_generate_uint64.
+ * The state is advanced serially but the tempering is done in a separate
+ * loop which the compiler can vectorize.
+ * @param random tinymt internal status
+ * @param out array of n 64-bit unsigned integers
+ * @param n number of values to generate
+ */
+inline static void tinymt64_generate_uint64_n(tinymt64_t *random,
+                                              uint64_t *out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    tinymt64_next_state(random);
+#if defined(LINEARITY_CHECK)
+    out[i] = random->status[0] ^ random->status[1];
+#else
+    out[i] = random->status[0] + random->status[1];
+#endif
+    out[i] ^= random->status[0] >> TINYMT64_SH8;
+  }
+  const uint64_t tmat = random->tmat;
+  for (size_t i = 0; i < n; i++) {
+    out[i] ^= -((int64_t)(out[i] & 1)) & tmat;
+  }
+}
+
+/**
+ * This function converts a value of tinymt64_generate_uint64 to a floating
+ * point number, the same as tinymt64_generate_doubleOO would return.
+ * @param x 64-bit unsigned integer
+ * @return floating point number r (0.0 < r < 1.0)
+ */
+inline static double tinymt64_uint64_to_doubleOO(uint64_t x) {
+  union {
+    uint64_t u;
+    double d;
+  } conv;
+  conv.u = (x >> 12) | UINT64_C(0x3ff0000000000001);
+  return conv.d - 1.0;
+}
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,209 @@
+/******************************************************************************
+ *                                                                            *
+ *  This file is part of Verificarlo.                                         *
+ *                                                                            *
+ *  Copyright (c) 2020                                                        *
+ *     Verificarlo contributors                                               *
+ *                                                                            *
+ *  Verificarlo is free software: you can redistribute it and/or modify       *
+ *  it under the terms of the GNU General Public License as published by      *
+ *  the Free Software Foundation, either version 3 of the License, or         *
+ *  (at your option) any later version.                                       *
+ *                                                                            *
+ *  Verificarlo is distributed in the hope that it will be useful,            *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ *  GNU General Public License for more details.                              *
+ *                                                                            *
+ *  You should have received a copy of the GNU General Public License         *
+ *  along with Verificarlo.  If not, see <http://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef __VFC_HASHMAP_HEADER__
+#include "vfc_hashmap.h"
+#endif
+#ifndef __VFC_CONCURRENT_MAP_HEADER__
+#include "vfc_concurrent_map.h"
+#endif
+
+#define CONCURRENT_MAP_INITIAL_CAPACITY 16
+
+/* The top bits of the hash select the shard, the low bits the slot */
+#define concurrent_map_shard(map, hash) (&(map)->shards[(hash) >> 58])
+
+static vfc_concurrent_map_table_t *concurrent_map_table_alloc(size_t capacity) {
+  vfc_concurrent_map_table_t *table =
+      calloc(1, sizeof(vfc_concurrent_map_table_t) +
+                    capacity * sizeof(vfc_concurrent_map_slot_t));
+  if (table == NULL) {
+    abort();
+  }
+  table->capacity = capacity;
+  return table;
+}
+
+// insertions are rare, a thread waiting for the lock lets the owner run
+static void concurrent_map_lock(vfc_concurrent_map_shard_t *shard) {
+  while (__atomic_test_and_set(&shard->lock, __ATOMIC_ACQUIRE)) {
+    sched_yield();
+  }
+}
+
+static void concurrent_map_unlock(vfc_concurrent_map_shard_t *shard) {
+  __atomic_clear(&shard->lock, __ATOMIC_RELEASE);
+}
+
+// slot of a key in a table, or NULL. The acquire loads are plain loads on
+// x86 and only order the reads of the value after the read of the key.
+static vfc_concurrent_map_slot_t *
+concurrent_map_find(vfc_concurrent_map_table_t *table, const char *key,
+                    uint64_t hash) {
+  const size_t mask = table->capacity - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    vfc_concurrent_map_slot_t *slot = &table->slots[i];
+    const char *slot_key = __atomic_load_n(&slot->key, __ATOMIC_ACQUIRE);
+    if (slot_key == NULL) {
+      return NULL;
+    }
+    if (slot->hash == hash && (slot_key == key || strcmp(slot_key, key) == 0)) {
+      return slot;
+    }
+  }
+}
+
+// free slot where a key would be inserted, with the shard locked
+static vfc_concurrent_map_slot_t *
+concurrent_map_find_free(vfc_concurrent_map_table_t *table, uint64_t hash) {
+  const size_t mask = table->capacity - 1;
+  size_t i = hash & mask;
+  while (table->slots[i].key != NULL) {
+    i = (i + 1) & mask;
+  }
+  return &table->slots[i];
+}
+
+// publish a table twice as large with the keys of the current one
+static void concurrent_map_grow(vfc_concurrent_map_shard_t *shard) {
+  vfc_concurrent_map_table_t *old = shard->table;
+  vfc_concurrent_map_table_t *table =
+      concurrent_map_table_alloc(old->capacity * 2);
+  for (size_t i = 0; i < old->capacity; i++) {
+    if (old->slots[i].key != NULL) {
+      *concurrent_map_find_free(table, old->slots[i].hash) = old->slots[i];
+    }
+  }
+  table->previous = old;
+  __atomic_store_n(&shard->table, table, __ATOMIC_RELEASE);
+}
+
+// allocate and initialize the map
+vfc_concurrent_map_t vfc_concurrent_map_create() {
+  vfc_concurrent_map_t map = aligned_alloc(
+      sizeof(vfc_concurrent_map_shard_t), sizeof(struct vfc_concurrent_map_st));
+
+  if (map == NULL) {
+    return NULL;
+  }
+  for (int i = 0; i < VFC_CONCURRENT_MAP_SHARDS; i++) {
+    map->shards[i].table =
+        concurrent_map_table_alloc(CONCURRENT_MAP_INITIAL_CAPACITY);
+    map->shards[i].nitems = 0;
+    map->shards[i].lock = 0;
+  }
+  return map;
+}
+
+// free the map
+void vfc_concurrent_map_destroy(vfc_concurrent_map_t map) {
+  if (map == NULL) {
+    return;
+  }
+  for (int i = 0; i < VFC_CONCURRENT_MAP_SHARDS; i++) {
+    vfc_concurrent_map_table_t *table = map->shards[i].table;
+    while (table != NULL) {
+      vfc_concurrent_map_table_t *previous = table->previous;
+      free(table);
+      table = previous;
+    }
+  }
+  free(map);
+}
+
+// get an element of the map
+void *vfc_concurrent_map_get(vfc_concurrent_map_t map, const char *key) {
+  const uint64_t hash = vfc_hashmap_str_function(key);
+  vfc_concurrent_map_shard_t *shard = concurrent_map_shard(map, hash);
+  vfc_concurrent_map_table_t *table =
+      __atomic_load_n(&shard->table, __ATOMIC_ACQUIRE);
+  vfc_concurrent_map_slot_t *slot = concurrent_map_find(table, key, hash);
+
+  return (slot != NULL) ? slot->value : NULL;
+}
+
+// insert an element if its key is not in the map
+void *vfc_concurrent_map_insert(vfc_concurrent_map_t map, const char *key,
+                                void *item) {
+  const uint64_t hash = vfc_hashmap_str_function(key);
+  vfc_concurrent_map_shard_t *shard = concurrent_map_shard(map, hash);
+
+  concurrent_map_lock(shard);
+  vfc_concurrent_map_slot_t *slot =
+      concurrent_map_find(shard->table, key, hash);
+  if (slot == NULL) {
+    /* keep at least half of the slots free */
+    if (2 * (shard->nitems + 1) > shard->table->capacity) {
+      concurrent_map_grow(shard);
+    }
+    slot = concurrent_map_find_free(shard->table, hash);
+    slot->hash = hash;
+    slot->value = item;
+    __atomic_store_n(&slot->key, key, __ATOMIC_RELEASE);
+    __atomic_store_n(&shard->nitems, shard->nitems + 1, __ATOMIC_RELAXED);
+  }
+  item = slot->value;
+  concurrent_map_unlock(shard);
+  return item;
+}
+
+// get the number of elements in the map
+size_t vfc_concurrent_map_num_items(vfc_concurrent_map_t map) {
+  size_t nitems = 0;
+  for (int i = 0; i < VFC_CONCURRENT_MAP_SHARDS; i++) {
+    nitems += __atomic_load_n(&map->shards[i].nitems, __ATOMIC_RELAXED);
+  }
+  return nitems;
+}
+
+// call a function on each element of the map
+void vfc_concurrent_map_foreach(vfc_concurrent_map_t map,
+                                void (*function)(const char *key, void *item,
+                                                 void *arg),
+                                void *arg) {
+  for (int i = 0; i < VFC_CONCURRENT_MAP_SHARDS; i++) {
+    vfc_concurrent_map_table_t *table =
+        __atomic_load_n(&map->shards[i].table, __ATOMIC_ACQUIRE);
+    for (size_t j = 0; j < table->capacity; j++) {
+      const char *key = __atomic_load_n(&table->slots[j].key, __ATOMIC_ACQUIRE);
+      if (key != NULL) {
+        function(key, table->slots[j].value, arg);
+      }
+    }
+  }
+}
+
+static void concurrent_map_free_item(const char *key __attribute__((unused)),
+                                     void *item,
+                                     void *arg __attribute__((unused))) {
+  free(item);
+}
+
+// Free the elements of the map
+void vfc_concurrent_map_free(vfc_concurrent_map_t map) {
+  vfc_concurrent_map_foreach(map, concurrent_map_free_item, NULL);
+}
@@ -0,0 +1,89 @@
+/******************************************************************************
+ *                                                                            *
+ *  This file is part of Verificarlo.                                         *
+ *                                                                            *
+ *  Copyright (c) 2020                                                        *
+ *     Verificarlo contributors                                               *
+ *                                                                            *
+ *  Verificarlo is free software: you can redistribute it and/or modify       *
+ *  it under the terms of the GNU General Public License as published by      *
+ *  the Free Software Foundation, either version 3 of the License, or         *
+ *  (at your option) any later version.                                       *
+ *                                                                            *
+ *  Verificarlo is distributed in the hope that it will be useful,            *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ *  GNU General Public License for more details.                              *
+ *                                                                            *
+ *  You should have received a copy of the GNU General Public License         *
+ *  along with Verificarlo.  If not, see <http://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef __VFC_CONCURRENT_MAP_H__
+#define __VFC_CONCURRENT_MAP_H__
+
+#define __VFC_CONCURRENT_MAP_HEADER__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Map with string keys shared by the threads of the instrumented program.
+ * Keys are inserted once and never removed. The map is split in shards
+ * selected by the hash of the keys. Lookups only load the slots of a shard,
+ * without locks nor read-modify-write atomics. Insertions lock their shard,
+ * fill a slot and publish its key last. A full shard is copied into a table
+ * twice as large; the previous tables are kept until the map is destroyed
+ * because lookups may still be reading them. */
+#define VFC_CONCURRENT_MAP_SHARDS 64
+
+typedef struct {
+  const char *key; /* NULL for free slots, set once the slot is filled */
+  void *value;
+  uint64_t hash;
+} vfc_concurrent_map_slot_t;
+
+typedef struct vfc_concurrent_map_table {
+  size_t capacity; /* number of slots, a power of two */
+  struct vfc_concurrent_map_table *previous;
+  vfc_concurrent_map_slot_t slots[];
+} vfc_concurrent_map_table_t;
+
+typedef struct {
+  vfc_concurrent_map_table_t *table;
+  size_t nitems;
+  char lock;
+} __attribute__((aligned(64))) vfc_concurrent_map_shard_t;
+
+struct vfc_concurrent_map_st {
+  vfc_concurrent_map_shard_t shards[VFC_CONCURRENT_MAP_SHARDS];
+};
+typedef struct vfc_concurrent_map_st *vfc_concurrent_map_t;
+
+// allocate and initialize the map
+vfc_concurrent_map_t vfc_concurrent_map_create();
+
+// free the map
+void vfc_concurrent_map_destroy(vfc_concurrent_map_t map);
+
+// get an element of the map
+void *vfc_concurrent_map_get(vfc_concurrent_map_t map, const char *key);
+
+// insert an element if its key is not in the map, return the element of the
+// key in the map
+void *vfc_concurrent_map_insert(vfc_concurrent_map_t map, const char *key,
+                                void *item);
+
+// get the number of elements in the map
+size_t vfc_concurrent_map_num_items(vfc_concurrent_map_t map);
+
+// call a function on each element of the map
+void vfc_concurrent_map_foreach(vfc_concurrent_map_t map,
+                                void (*function)(const char *key, void *item,
+                                                 void *arg),
+                                void *arg);
+
+// Free the elements of the map
+void vfc_concurrent_map_free(vfc_concurrent_map_t map);
+
+#endif
@@ -15,72 +15,155 @@
  *   limitations under the License.
  */
 
+#include <stdint.h>
 #include <stdlib.h>
-
-#define HASH_MULTIPLIER 31
-static const unsigned int hashmap_prime_1 = 73;
-static const unsigned int hashmap_prime_2 = 5009;
+#include <string.h>
 
 #ifndef __VFC_HASHMAP_HEADER__
+#include "vfc_hashmap.h"
+#endif
 
-struct vfc_hashmap_st {
-  size_t nbits;
-  size_t mask;
+#define HASHMAP_GROUP_SIZE 8
+#define HASHMAP_INITIAL_CAPACITY 64
 
-  size_t capacity;
-  size_t *items;
-  size_t nitems;
-  size_t n_deleted_items;
-};
-typedef struct vfc_hashmap_st *vfc_hashmap_t;
+/* Control bytes of the free slots, the full slots hold the 7 low bits of the
+ * hash of their key */
+#define HASHMAP_EMPTY UINT64_C(0x80)
+#define HASHMAP_DELETED UINT64_C(0xfe)
 
-// allocate and initialize the map
-vfc_hashmap_t vfc_hashmap_create();
+#define HASHMAP_LSBS UINT64_C(0x0101010101010101)
+#define HASHMAP_MSBS UINT64_C(0x8080808080808080)
 
-// get the value at an index of a map
-size_t get_value_at(size_t *items, size_t i);
+#define HASHMAP_SEED UINT64_C(0xa0761d6478bd642f)
+#define HASHMAP_K1 UINT64_C(0xe7037ed1a0b428db)
+#define HASHMAP_K2 UINT64_C(0x8ebc6af09c88c6e3)
 
-// get the key at an index of a map
-size_t get_key_at(size_t *items, size_t i);
+#define hashmap_h1(hash) ((hash) >> 7)
+#define hashmap_h2(hash) ((hash)&0x7f)
 
-// set the value at an index of a map
-void set_value_at(size_t *items, size_t value, size_t i);
+/* Keys and deleted slots fill at most 7/8 of the slots, so that probing
+ * always ends on an empty slot */
+#define hashmap_max_load(capacity) ((capacity) - (capacity) / 8)
 
-// set the key at an index of a map
-void set_key_at(size_t *items, size_t key, size_t i);
+/* Index in its group of the first slot of a match */
+#define hashmap_first(match) ((size_t)__builtin_ctzll(match) / 8)
 
-// free the map
-void vfc_hashmap_destroy(vfc_hashmap_t map);
+/***************** Verificarlo hashmap FUNCTIONS ********************
+ * The following set of functions are used in backends and wrapper
+ * to stock and access quickly internal data.
+ *******************************************************************/
 
-// insert an element in the map
-void vfc_hashmap_insert(vfc_hashmap_t map, size_t key, void *item);
+// slots of a group whose control byte is h2, as the most significant bit of
+// their byte. A slot following a match may be reported too, the keys of the
+// matches are compared anyway.
+static inline uint64_t hashmap_match(uint64_t ctrl, uint64_t h2) {
+  const uint64_t x = ctrl ^ (HASHMAP_LSBS * h2);
+  return (x - HASHMAP_LSBS) & ~x & HASHMAP_MSBS;
+}
 
-// remove an element of the map
-void vfc_hashmap_remove(vfc_hashmap_t map, size_t key);
+// empty slots of a group
+static inline uint64_t hashmap_match_empty(uint64_t ctrl) {
+  return ctrl & ~(ctrl << 1) & HASHMAP_MSBS;
+}
 
-// test if an element is in the map
-char vfc_hashmap_have(vfc_hashmap_t map, size_t key);
+// empty or deleted slots of a group
+static inline uint64_t hashmap_match_free(uint64_t ctrl) {
+  return ctrl & HASHMAP_MSBS;
+}
 
-// get an element of the map
-void *vfc_hashmap_get(vfc_hashmap_t map, size_t key);
+static inline uint64_t hashmap_get_ctrl(vfc_hashmap_t map, size_t i) {
+  const int shift = (i % HASHMAP_GROUP_SIZE) * 8;
+  return (map->ctrl[i / HASHMAP_GROUP_SIZE] >> shift) & 0xff;
+}
 
-// get the number of elements in the map
-size_t vfc_hashmap_num_items(vfc_hashmap_t map);
+static inline void hashmap_set_ctrl(vfc_hashmap_t map, size_t i, uint64_t c) {
+  const int shift = (i % HASHMAP_GROUP_SIZE) * 8;
+  uint64_t *word = &map->ctrl[i / HASHMAP_GROUP_SIZE];
+  *word = (*word & ~(UINT64_C(0xff) << shift)) | (c << shift);
+}
 
-// Hash function
-size_t vfc_hashmap_str_function(const char *id);
+// index of the slot of a key, or the capacity if the key is not in the map.
+// Groups are probed in triangular order, which visits all of them since
+// their number is a power of two.
+static size_t hashmap_find(vfc_hashmap_t map, const char *key, uint64_t hash) {
+  const size_t mask = map->capacity / HASHMAP_GROUP_SIZE - 1;
+  size_t group = hashmap_h1(hash) & mask;
+  for (size_t step = 1;; step++) {
+    const uint64_t ctrl = map->ctrl[group];
+    for (uint64_t match = hashmap_match(ctrl, hashmap_h2(hash)); match != 0;
+         match &= match - 1) {
+      const size_t i = group * HASHMAP_GROUP_SIZE + hashmap_first(match);
+      /* ids are usually looked up with the pointer they were inserted with */
+      if (map->slots[i].hash == hash &&
+          (map->slots[i].key == key || strcmp(map->slots[i].key, key) == 0)) {
+        return i;
+      }
+    }
+    if (hashmap_match_empty(ctrl) != 0) {
+      return map->capacity;
+    }
+    group = (group + step) & mask;
+  }
+}
 
-#endif
+// index of the first free slot on the probing sequence of a hash
+static size_t hashmap_find_free(vfc_hashmap_t map, uint64_t hash) {
+  const size_t mask = map->capacity / HASHMAP_GROUP_SIZE - 1;
+  size_t group = hashmap_h1(hash) & mask;
+  for (size_t step = 1;; step++) {
+    const uint64_t match = hashmap_match_free(map->ctrl[group]);
+    if (match != 0) {
+      return group * HASHMAP_GROUP_SIZE + hashmap_first(match);
+    }
+    group = (group + step) & mask;
+  }
+}
 
-/***************** Verificarlo hashmap FUNCTIONS ********************
- * The following set of functions are used in backends and wrapper
- * to stock and access quickly internal data.
- *******************************************************************/
+// allocate empty slots
+static int hashmap_alloc(vfc_hashmap_t map, size_t capacity) {
+  map->ctrl = malloc(capacity / HASHMAP_GROUP_SIZE * sizeof(uint64_t));
+  map->slots = calloc(capacity, sizeof(vfc_hashmap_slot_t));
+  if (map->ctrl == NULL || map->slots == NULL) {
+    return -1;
+  }
+  memset(map->ctrl, HASHMAP_EMPTY, capacity / HASHMAP_GROUP_SIZE * 8);
+  map->capacity = capacity;
+  map->nitems = 0;
+  map->growth_left = hashmap_max_load(capacity);
+  return 0;
+}
+
+// move the keys to new slots, which also drops the deleted slots
+static void hashmap_resize(vfc_hashmap_t map, size_t capacity) {
+  uint64_t *old_ctrl = map->ctrl;
+  vfc_hashmap_slot_t *old_slots = map->slots;
+  const size_t old_capacity = map->capacity;
+  const size_t nitems = map->nitems;
+
+  if (hashmap_alloc(map, capacity) != 0) {
+    abort();
+  }
+  for (size_t ii = 0; ii < old_capacity; ii++) {
+    const uint64_t c = (old_ctrl[ii / HASHMAP_GROUP_SIZE] >>
+                        (ii % HASHMAP_GROUP_SIZE * 8)) &
+                       0xff;
+    if (c < HASHMAP_EMPTY) {
+      const size_t i = hashmap_find_free(map, old_slots[ii].hash);
+      hashmap_set_ctrl(map, i, c);
+      map->slots[i] = old_slots[ii];
+    }
+  }
+  map->nitems = nitems;
+  map->growth_left -= nitems;
+  free(old_ctrl);
+  free(old_slots);
+}
 
 // free the map
 void vfc_hashmap_destroy(vfc_hashmap_t map) {
   if (map) {
-    free(map->items);
+    free(map->ctrl);
+    free(map->slots);
   }
   free(map);
 }
@@ -92,157 +175,113 @@ vfc_hashmap_t vfc_hashmap_create() {
   if (map == NULL) {
     return NULL;
   }
-  map->nbits = 3;
-  map->capacity = (size_t)(1 << map->nbits);
-  map->mask = map->capacity - 1;
-  // an item is now a value and a key
-  map->items = calloc(map->capacity, 2 * sizeof(size_t));
-  if (map->items == NULL) {
+  if (hashmap_alloc(map, HASHMAP_INITIAL_CAPACITY) != 0) {
     vfc_hashmap_destroy(map);
     return NULL;
   }
-  map->nitems = 0;
-  map->n_deleted_items = 0;
   return map;
 }
 
-size_t get_value_at(size_t *items, size_t i) { return items[i * 2]; }
-
-size_t get_key_at(size_t *items, size_t i) { return items[(i * 2) + 1]; }
-
-void set_value_at(size_t *items, size_t value, size_t i) {
-  items[i * 2] = value;
+void *vfc_hashmap_value_at(vfc_hashmap_t map, size_t i) {
+  return (hashmap_get_ctrl(map, i) < HASHMAP_EMPTY) ? map->slots[i].value
+                                                    : NULL;
 }
 
-void set_key_at(size_t *items, size_t key, size_t i) {
-  items[(i * 2) + 1] = key;
+const char *vfc_hashmap_key_at(vfc_hashmap_t map, size_t i) {
+  return (hashmap_get_ctrl(map, i) < HASHMAP_EMPTY) ? map->slots[i].key : NULL;
 }
 
-// add a member in the table
-static int hashmap_add_member(vfc_hashmap_t map, size_t key, void *item) {
-  size_t value = (size_t)item;
-  size_t ii;
+// insert an element in the map
+void vfc_hashmap_insert(vfc_hashmap_t map, const char *key, void *item) {
+  const uint64_t hash = vfc_hashmap_str_function(key);
+  size_t i = hashmap_find(map, key, hash);
 
-  if (value == 0 || value == 1) {
-    return -1;
+  if (i != map->capacity) {
+    map->slots[i].value = item;
+    return;
   }
 
-  ii = map->mask & (hashmap_prime_1 * key);
-
-  while (get_value_at(map->items, ii) != 0 &&
-         get_value_at(map->items, ii) != 1) {
-    if (get_value_at(map->items, ii) == value) {
-      return 0;
-    } else {
-      /* search free slot */
-      ii = map->mask & (ii + hashmap_prime_2);
-    }
-  }
-  map->nitems++;
-  if (get_value_at(map->items, ii) == 1) {
-    map->n_deleted_items--;
+  i = hashmap_find_free(map, hash);
+  if (map->growth_left == 0 && hashmap_get_ctrl(map, i) == HASHMAP_EMPTY) {
+    /* grow when keys fill half of the maximal load, otherwise deleted slots
+     * are the majority and are only dropped */
+    const size_t capacity = (map->nitems >= hashmap_max_load(map->capacity) / 2)
+                                ? map->capacity * 2
+                                : map->capacity;
+    hashmap_resize(map, capacity);
+    i = hashmap_find_free(map, hash);
   }
 
-  set_value_at(map->items, value, ii);
-  set_key_at(map->items, key, ii);
-
-  return 1;
-}
-
-// rehash the table if necessary
-static void maybe_rehash_map(vfc_hashmap_t map) {
-  size_t *old_items;
-  size_t old_capacity, ii;
-
-  if (map->nitems + map->n_deleted_items >= (double)map->capacity * 0.85) {
-    old_items = map->items;
-    old_capacity = map->capacity;
-    map->nbits++;
-    map->capacity = (size_t)(1 << map->nbits);
-    map->mask = map->capacity - 1;
-    map->items = calloc(map->capacity, 2 * sizeof(size_t));
-    map->nitems = 0;
-    map->n_deleted_items = 0;
-    for (ii = 0; ii < old_capacity; ii++) {
-      hashmap_add_member(map, get_key_at(old_items, ii),
-                         (void *)get_value_at(old_items, ii));
-    }
-    free(old_items);
+  if (hashmap_get_ctrl(map, i) == HASHMAP_EMPTY) {
+    map->growth_left--;
   }
-}
-
-// insert an element in the map
-void vfc_hashmap_insert(vfc_hashmap_t map, size_t key, void *item) {
-  hashmap_add_member(map, key, item);
-  maybe_rehash_map(map);
+  hashmap_set_ctrl(map, i, hashmap_h2(hash));
+  map->slots[i].hash = hash;
+  map->slots[i].key = key;
+  map->slots[i].value = item;
+  map->nitems++;
 }
 
 // remove an element of the map
-void vfc_hashmap_remove(vfc_hashmap_t map, size_t key) {
-  size_t ii = map->mask & (hashmap_prime_1 * key);
-
-  while (get_value_at(map->items, ii) != 0) {
-    if (get_key_at(map->items, ii) == key) {
-      set_value_at(map->items, 1, ii);
-      map->nitems--;
-      map->n_deleted_items++;
-      break;
-    } else {
-      ii = map->mask & (ii + hashmap_prime_2);
-    }
+void vfc_hashmap_remove(vfc_hashmap_t map, const char *key) {
+  const size_t i = hashmap_find(map, key, vfc_hashmap_str_function(key));
+
+  if (i == map->capacity) {
+    return;
+  }
+  /* A probe only goes past a group without empty slots, the slot can be
+   * emptied if its group still has one */
+  if (hashmap_match_empty(map->ctrl[i / HASHMAP_GROUP_SIZE]) != 0) {
+    hashmap_set_ctrl(map, i, HASHMAP_EMPTY);
+    map->growth_left++;
+  } else {
+    hashmap_set_ctrl(map, i, HASHMAP_DELETED);
   }
+  map->slots[i].key = NULL;
+  map->slots[i].value = NULL;
+  map->nitems--;
 }
 
 // test if an element is in the map
-char vfc_hashmap_have(vfc_hashmap_t map, size_t key) {
-  size_t ii = map->mask & (hashmap_prime_1 * key);
-
-  while (get_value_at(map->items, ii) != 0) {
-    if (get_key_at(map->items, ii) == key) {
-      return 1;
-    } else {
-      ii = map->mask & (ii + hashmap_prime_2);
-    }
-  }
-  return 0;
+char vfc_hashmap_have(vfc_hashmap_t map, const char *key) {
+  return hashmap_find(map, key, vfc_hashmap_str_function(key)) !=
+         map->capacity;
 }
 
 // get an element of the map
-void *vfc_hashmap_get(vfc_hashmap_t map, size_t key) {
-  size_t ii = map->mask & (hashmap_prime_1 * key);
-
-  while (get_value_at(map->items, ii) != 0) {
-    if (get_key_at(map->items, ii) == key) {
-      return (void *)get_value_at(map->items, ii);
-    } else {
-      ii = map->mask & (ii + hashmap_prime_2);
-    }
-  }
-  return NULL;
+void *vfc_hashmap_get(vfc_hashmap_t map, const char *key) {
+  const size_t i = hashmap_find(map, key, vfc_hashmap_str_function(key));
+
+  return (i != map->capacity) ? map->slots[i].value : NULL;
 }
 
 // get the number of elements in the map
 size_t vfc_hashmap_num_items(vfc_hashmap_t map) { return map->nitems; }
 
-// Hash function for strings
-size_t vfc_hashmap_str_function(const char *id) {
-  unsigned const char *us;
-
-  us = (unsigned const char *)id;
+// multiply on 128 bits and fold the product
+static inline uint64_t hashmap_mix(uint64_t a, uint64_t b) {
+  const unsigned __int128 r = (unsigned __int128)a * b;
+  return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
 
-  size_t index = 0;
+// Hash function for strings, reads them by 8 bytes
+uint64_t vfc_hashmap_str_function(const char *id) {
+  const size_t len = strlen(id);
+  uint64_t hash = HASHMAP_SEED ^ len;
+  uint64_t word;
+  size_t i = 0;
 
-  while (*us != '\0') {
-    index = index * HASH_MULTIPLIER + *us;
-    us++;
+  for (; i + 8 <= len; i += 8) {
+    memcpy(&word, id + i, 8);
+    hash = hashmap_mix(hash ^ word, HASHMAP_K1);
   }
-
-  return index;
+  word = 0;
+  memcpy(&word, id + i, len - i);
+  return hashmap_mix(hashmap_mix(hash ^ word, HASHMAP_K1), HASHMAP_K2);
 }
 
 // Free the hashmap
 void vfc_hashmap_free(vfc_hashmap_t map) {
-  for (int ii = 0; ii < map->capacity; ii++)
-    if (get_value_at(map->items, ii) != 0 && get_value_at(map->items, ii) != 0)
-      free((void *)get_value_at(map->items, ii));
-}
\ No newline at end of file
+  for (size_t ii = 0; ii < map->capacity; ii++)
+    free(vfc_hashmap_value_at(map, ii));
+}
@@ -20,54 +20,61 @@
 
 #define __VFC_HASHMAP_HEADER__
 
-struct vfc_hashmap_st {
-  size_t nbits;
-  size_t mask;
+#include <stddef.h>
+#include <stdint.h>
+
+/* Open-addressing hashmap with string keys. The slots are split in groups of
+ * eight, each group has a 64-bit word holding one control byte per slot:
+ * empty, deleted or the 7 low bits of the hash of the key. Lookups compare the
+ * control bytes of a whole group at once and only compare the keys of the
+ * slots whose byte matches. The keys are not copied, they must stay valid
+ * while they are in the map. */
+typedef struct {
+  uint64_t hash;
+  const char *key;
+  void *value;
+} vfc_hashmap_slot_t;
 
-  size_t capacity;
-  size_t *items;
-  size_t nitems;
-  size_t n_deleted_items;
+struct vfc_hashmap_st {
+  size_t capacity;    /* number of slots, a power of two */
+  size_t nitems;      /* number of keys */
+  size_t growth_left; /* insertions in empty slots before growing */
+  uint64_t *ctrl;     /* control bytes, one word per group */
+  vfc_hashmap_slot_t *slots;
 };
 typedef struct vfc_hashmap_st *vfc_hashmap_t;
 
 // allocate and initialize the map
 vfc_hashmap_t vfc_hashmap_create();
 
-// get the value at an index of a map
-size_t get_value_at(size_t *items, size_t i);
-
-// get the key at an index of a map
-size_t get_key_at(size_t *items, size_t i);
-
-// set the value at an index of a map
-void set_value_at(size_t *items, size_t value, size_t i);
-
-// set the key at an index of a map
-void set_key_at(size_t *items, size_t key, size_t i);
-
 // free the map
 void vfc_hashmap_destroy(vfc_hashmap_t map);
 
-// insert an element in the map
-void vfc_hashmap_insert(vfc_hashmap_t map, size_t key, void *item);
+// get the value at an index of a map, NULL if the slot is free
+void *vfc_hashmap_value_at(vfc_hashmap_t map, size_t i);
+
+// get the key at an index of a map, NULL if the slot is free
+const char *vfc_hashmap_key_at(vfc_hashmap_t map, size_t i);
+
+// insert an element in the map, replacing the element of the same key
+void vfc_hashmap_insert(vfc_hashmap_t map, const char *key, void *item);
 
 // remove an element of the map
-void vfc_hashmap_remove(vfc_hashmap_t map, size_t key);
+void vfc_hashmap_remove(vfc_hashmap_t map, const char *key);
 
 // test if an element is in the map
-char vfc_hashmap_have(vfc_hashmap_t map, size_t key);
+char vfc_hashmap_have(vfc_hashmap_t map, const char *key);
 
 // get an element of the map
-void *vfc_hashmap_get(vfc_hashmap_t map, size_t key);
+void *vfc_hashmap_get(vfc_hashmap_t map, const char *key);
 
 // get the number of elements in the map
 size_t vfc_hashmap_num_items(vfc_hashmap_t map);
 
 // Hash function for strings
-size_t vfc_hashmap_str_function(const char *id);
+uint64_t vfc_hashmap_str_function(const char *id);
 
 // Free the hashmap
 void vfc_hashmap_free(vfc_hashmap_t map);
 
-#endif
\ No newline at end of file
+#endif
@@ -44,6 +44,7 @@
 #include <cxxabi.h>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <set>
 #include <stdio.h>
 #include <utility>
@@ -59,8 +60,43 @@ static Function *func_exit;
 // Enumeration of managed types
 enum Ftypes { FLOAT, DOUBLE };
 
-// Array of values
-Value *Types2val[] = {NULL, NULL};
+// Type of the call-site descriptors, the layout must match
+// interflop_function_info_t
+StructType *FunctionInfoTy = NULL;
+
+// Returns the descriptor of an instrumented call site, emitted in the
+// vfc_functions section. The last field is left to the backends, which may
+// attach their data for the call site to it at runtime.
+Constant *getFunctionInfo(Module &M, const std::string &id,
+                          bool is_from_library, bool is_intrinsic,
+                          bool use_float, bool use_double) {
+  LLVMContext &C = M.getContext();
+  Type *Int16Ty = Type::getInt16Ty(C);
+
+  Constant *data = ConstantDataArray::getString(C, id);
+  GlobalVariable *str = new GlobalVariable(
+      M, data->getType(), true, GlobalValue::PrivateLinkage, data, ".str");
+  Constant *zero = ConstantInt::get(Type::getInt32Ty(C), 0);
+  Constant *indices[] = {zero, zero};
+
+  Constant *fields[] = {
+      ConstantExpr::getGetElementPtr(data->getType(), str, indices),
+      ConstantInt::get(Int16Ty, is_from_library),
+      ConstantInt::get(Int16Ty, is_intrinsic),
+      ConstantInt::get(Int16Ty, use_float),
+      ConstantInt::get(Int16Ty, use_double),
+      ConstantPointerNull::get(Type::getInt8PtrTy(C))};
+  GlobalVariable *info = new GlobalVariable(
+      M, FunctionInfoTy, false, GlobalValue::PrivateLinkage,
+      ConstantStruct::get(FunctionInfoTy, fields), "vfc_function");
+  info->setSection("vfc_functions");
+#if LLVM_VERSION_MAJOR < 10
+  info->setAlignment(8);
+#else
+  info->setAlignment(MaybeAlign(8));
+#endif
+  return info;
+}
 
 // Demangling function
 std::string demangle(std::string src) {
@@ -130,118 +166,169 @@ void haveFloatingPointArithmetic(Instruction *call, Function *f,
   }
 }
 
-void InstrumentFunction(std::vector<Value *> MetaData,
-                        Function *CurrentFunction, Function *HookedFunction,
-                        const CallInst *call, BasicBlock *B) {
-  IRBuilder<> Builder(B);
+// Signatures emitted in the module, by structure of floating point values
+std::map<StructType *, Constant *> Signatures;
 
-  // Step 1: add space on the heap for poiters
-  size_t input_cpt = 0;
-  std::vector<Value *> InputAlloca;
-  for (auto &args : CurrentFunction->args()) {
-    if (args.getType() == Builder.getDoubleTy()) {
-      InputAlloca.push_back(
-          Builder.CreateAlloca(Builder.getDoubleTy(), nullptr));
-      input_cpt++;
-    } else if (args.getType() == Builder.getFloatTy()) {
-      InputAlloca.push_back(
-          Builder.CreateAlloca(Builder.getFloatTy(), nullptr));
-      input_cpt++;
-    }
+// Returns the constant signature of the floating point values stored in a
+// structure of type ValuesTy. The layout must match
+// interflop_function_signature_t.
+Constant *getSignature(Module &M, StructType *ValuesTy) {
+  auto s = Signatures.find(ValuesTy);
+  if (s != Signatures.end()) {
+    return s->second;
   }
 
-  std::vector<Value *> InputMetaData = MetaData;
-  InputMetaData.push_back(ConstantInt::get(Builder.getInt32Ty(), input_cpt));
-
-  size_t output_cpt = 0;
-  std::vector<Value *> OutputAlloca;
-  if (HookedFunction->getReturnType() == Builder.getDoubleTy()) {
-    OutputAlloca.push_back(
-        Builder.CreateAlloca(Builder.getDoubleTy(), nullptr));
-    output_cpt++;
-  } else if (HookedFunction->getReturnType() == Builder.getFloatTy()) {
-    OutputAlloca.push_back(Builder.CreateAlloca(Builder.getFloatTy(), nullptr));
-    output_cpt++;
+  LLVMContext &C = M.getContext();
+  Type *Int16Ty = Type::getInt16Ty(C);
+  StructType *ArgTy = StructType::get(C, {Int16Ty, Int16Ty});
+  const StructLayout *Layout = M.getDataLayout().getStructLayout(ValuesTy);
+
+  std::vector<Constant *> Args;
+  for (unsigned i = 0; i < ValuesTy->getNumElements(); i++) {
+    Ftypes type = ValuesTy->getElementType(i)->isDoubleTy() ? DOUBLE : FLOAT;
+    Constant *fields[] = {
+        ConstantInt::get(Int16Ty, type),
+        ConstantInt::get(Int16Ty, Layout->getElementOffset(i))};
+    Args.push_back(ConstantStruct::get(ArgTy, fields));
   }
 
-  std::vector<Value *> OutputMetaData = MetaData;
-  OutputMetaData.push_back(ConstantInt::get(Builder.getInt32Ty(), output_cpt));
-
-  // Step 2: store values
-  std::vector<Value *> EnterArgs = InputMetaData;
-  size_t index = 0;
-  for (auto &args : CurrentFunction->args()) {
-    if (args.getType() == Builder.getDoubleTy()) {
-      EnterArgs.push_back(Types2val[DOUBLE]);
-      EnterArgs.push_back(InputAlloca[index]);
-      Builder.CreateStore(&args, InputAlloca[index++]);
-    } else if (args.getType() == Builder.getFloatTy()) {
-      EnterArgs.push_back(Types2val[FLOAT]);
-      EnterArgs.push_back(InputAlloca[index]);
-      Builder.CreateStore(&args, InputAlloca[index++]);
+  Constant *fields[] = {
+      ConstantInt::get(Type::getInt32Ty(C), Args.size()),
+      ConstantArray::get(ArrayType::get(ArgTy, Args.size()), Args)};
+  Constant *signature = ConstantStruct::getAnon(C, fields);
+  GlobalVariable *gv = new GlobalVariable(M, signature->getType(), true,
+                                          GlobalValue::PrivateLinkage,
+                                          signature, "vfc_signature");
+  Constant *ptr = ConstantExpr::getBitCast(gv, Type::getInt8PtrTy(C));
+  Signatures[ValuesTy] = ptr;
+  return ptr;
+}
+
+bool isFloatingPoint(Type *T) { return T->isFloatTy() || T->isDoubleTy(); }
+
+// Stores the floating point values in a structure allocated on the stack,
+// returns the structure, or a null pointer without floating point values
+Value *storeValues(IRBuilder<> &Builder, StructType *ValuesTy,
+                   std::vector<Value *> &Values) {
+  if (ValuesTy->getNumElements() == 0) {
+    return ConstantPointerNull::get(Builder.getInt8PtrTy());
+  }
+  Value *Struct = Builder.CreateAlloca(ValuesTy, nullptr);
+  unsigned index = 0;
+  for (auto &value : Values) {
+    if (isFloatingPoint(value->getType())) {
+      Builder.CreateStore(value,
+                          Builder.CreateStructGEP(ValuesTy, Struct, index++));
     }
   }
+  return Struct;
+}
 
-  // Step 3: call vfc_enter
-  Builder.CreateCall(func_enter, EnterArgs);
-
-  // Step 4: load modified values
-  std::vector<Value *> FunctionArgs;
-  index = 0;
-  for (auto &args : CurrentFunction->args()) {
-    if (args.getType() == Builder.getDoubleTy()) {
-      FunctionArgs.push_back(
-          Builder.CreateLoad(Builder.getDoubleTy(), InputAlloca[index++]));
-    } else if (args.getType() == Builder.getFloatTy()) {
-      FunctionArgs.push_back(
-          Builder.CreateLoad(Builder.getFloatTy(), InputAlloca[index++]));
-    } else {
-      FunctionArgs.push_back(&args);
+// Loads back the floating point values modified by the backends
+void loadValues(IRBuilder<> &Builder, StructType *ValuesTy, Value *Struct,
+                std::vector<Value *> &Values) {
+  unsigned index = 0;
+  for (auto &value : Values) {
+    if (isFloatingPoint(value->getType())) {
+      value = Builder.CreateLoad(
+          value->getType(), Builder.CreateStructGEP(ValuesTy, Struct, index++));
     }
   }
+}
 
-  // Step 5: call hooked function with modified values
-  Value *ret;
-  if (call) {
-    CallInst *hook = cast<CallInst>(call->clone());
-    int i = 0;
-    for (auto &args : FunctionArgs)
-      hook->setArgOperand(i++, args);
-    ret = Builder.Insert(hook);
-  } else {
-    ret = Builder.CreateCall(HookedFunction, FunctionArgs);
+// Returns the structure type of the floating point values
+StructType *getValuesType(LLVMContext &C, std::vector<Value *> &Values) {
+  std::vector<Type *> Types;
+  for (auto &value : Values) {
+    if (isFloatingPoint(value->getType())) {
+      Types.push_back(value->getType());
+    }
   }
+  return StructType::get(C, Types);
+}
+
+// Instruments the call of HookedFunction with the arguments FunctionArgs,
+// the body is emitted in the block B
+void InstrumentFunction(Value *FunctionInfo, std::vector<Value *> FunctionArgs,
+                        Function *HookedFunction, BasicBlock *B) {
+  IRBuilder<> Builder(B);
+  Module &M = *B->getModule();
+
+  // Step 1: store the floating point arguments in a structure
+  StructType *InputTy = getValuesType(M.getContext(), FunctionArgs);
+  Value *Inputs = storeValues(Builder, InputTy, FunctionArgs);
+
+  // Step 2: call vfc_enter
+  Builder.CreateCall(
+      func_enter, {FunctionInfo, getSignature(M, InputTy),
+                   Builder.CreatePointerCast(Inputs, Builder.getInt8PtrTy())});
 
-  // Step 6: store return value
-  std::vector<Value *> ExitArgs = OutputMetaData;
-  if (ret->getType() == Builder.getDoubleTy()) {
-    ExitArgs.push_back(Types2val[DOUBLE]);
-    ExitArgs.push_back(OutputAlloca[0]);
-    Builder.CreateStore(ret, OutputAlloca[0]);
-  } else if (ret->getType() == Builder.getFloatTy()) {
-    ExitArgs.push_back(Types2val[FLOAT]);
-    ExitArgs.push_back(OutputAlloca[0]);
-    Builder.CreateStore(ret, OutputAlloca[0]);
+  // Step 3: load modified values
+  if (InputTy->getNumElements() > 0) {
+    loadValues(Builder, InputTy, Inputs, FunctionArgs);
   }
 
-  // Step 7: call vfc_exit
-  Builder.CreateCall(func_exit, ExitArgs);
+  // Step 4: call hooked function with modified values
+  CallInst *ret = Builder.CreateCall(HookedFunction, FunctionArgs);
+  ret->setCallingConv(HookedFunction->getCallingConv());
+  ret->setAttributes(HookedFunction->getAttributes());
 
-  // Step 8: load the modified return value
-  if (ret->getType() == Builder.getDoubleTy()) {
-    ret = Builder.CreateLoad(Builder.getDoubleTy(), OutputAlloca[0]);
-  } else if (ret->getType() == Builder.getFloatTy()) {
-    ret = Builder.CreateLoad(Builder.getFloatTy(), OutputAlloca[0]);
+  // Step 5: store return value
+  std::vector<Value *> Outputs{ret};
+  StructType *OutputTy = getValuesType(M.getContext(), Outputs);
+  Value *Output = storeValues(Builder, OutputTy, Outputs);
+
+  // Step 6: call vfc_exit
+  Builder.CreateCall(
+      func_exit, {FunctionInfo, getSignature(M, OutputTy),
+                  Builder.CreatePointerCast(Output, Builder.getInt8PtrTy())});
+
+  // Step 7: load the modified return value
+  if (OutputTy->getNumElements() > 0) {
+    loadValues(Builder, OutputTy, Output, Outputs);
   }
 
-  // Step 9: return the modified return value if necessary
+  // Step 8: return the modified return value if necessary
   if (HookedFunction->getReturnType() != Builder.getVoidTy()) {
-    Builder.CreateRet(ret);
+    Builder.CreateRet(Outputs[0]);
   } else {
     Builder.CreateRetVoid();
   }
 }
 
+// Hooks emitted in the module, by callee and type of the hook
+std::map<std::pair<Function *, FunctionType *>, Function *> Hooks;
+
+// Returns the hook of the calls of f with arguments of types CallTypes. The
+// hook takes the arguments of the call followed by the call-site descriptor,
+// all the calls of f with the same types share it.
+Function *getHook(Module &M, Function *f, std::vector<Type *> CallTypes) {
+  CallTypes.push_back(PointerType::getUnqual(FunctionInfoTy));
+  FunctionType *HookTy =
+      FunctionType::get(f->getReturnType(), CallTypes, false);
+
+  Function *&hook_func = Hooks[std::make_pair(f, HookTy)];
+  if (hook_func) {
+    return hook_func;
+  }
+
+  hook_func = Function::Create(HookTy, GlobalValue::InternalLinkage,
+                               "vfc_" + f->getName().str() + "_hook", &M);
+  hook_func->setAttributes(f->getAttributes());
+  hook_func->setCallingConv(f->getCallingConv());
+
+  std::vector<Value *> FunctionArgs;
+  for (auto &args : hook_func->args()) {
+    FunctionArgs.push_back(&args);
+  }
+  Value *FunctionInfo = FunctionArgs.back();
+  FunctionArgs.pop_back();
+
+  BasicBlock *block = BasicBlock::Create(M.getContext(), "block", hook_func);
+  InstrumentFunction(FunctionInfo, FunctionArgs, f, block);
+  return hook_func;
+}
+
 struct VfclibFunc : public ModulePass {
   static char ID;
   std::vector<Function *> OriginalFunctions;
@@ -258,8 +345,8 @@ struct VfclibFunc : public ModulePass {
     const TargetLibraryInfo *TLI =
         &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
 
-    Types2val[0] = ConstantInt::get(Type::getInt32Ty(M.getContext()), 0);
-    Types2val[1] = ConstantInt::get(Type::getInt32Ty(M.getContext()), 1);
+    Signatures.clear();
+    Hooks.clear();
 
     /*************************************************************************
      *                  Get original functions's names                       *
@@ -273,23 +360,29 @@ struct VfclibFunc : public ModulePass {
      *                  Enter and exit functions declarations                *
      *************************************************************************/
 
-    std::vector<Type *> ArgTypes{
-        Type::getInt8PtrTy(M.getContext()), Type::getInt8Ty(M.getContext()),
-        Type::getInt8Ty(M.getContext()),    Type::getInt8Ty(M.getContext()),
-        Type::getInt8Ty(M.getContext()),    Type::getInt32Ty(M.getContext())};
+    Type *Int16Ty = Type::getInt16Ty(M.getContext());
+    FunctionInfoTy = StructType::get(
+        M.getContext(), {Type::getInt8PtrTy(M.getContext()), Int16Ty, Int16Ty,
+                         Int16Ty, Int16Ty, Type::getInt8PtrTy(M.getContext())});
+
+    std::vector<Type *> ArgTypes{PointerType::getUnqual(FunctionInfoTy),
+                                 Type::getInt8PtrTy(M.getContext()),
+                                 Type::getInt8PtrTy(M.getContext())};
 
-    // void vfc_enter_function (char*, char, char, char, char, int, ...)
+    // void vfc_enter_function (interflop_function_info_t*,
+    //                          interflop_function_signature_t*, void*)
     Constant *func = M.getOrInsertFunction(
         "vfc_enter_function",
-        FunctionType::get(Type::getVoidTy(M.getContext()), ArgTypes, true));
+        FunctionType::get(Type::getVoidTy(M.getContext()), ArgTypes, false));
 
     func_enter = cast<Function>(func);
     func_enter->setCallingConv(CallingConv::C);
 
-    // void vfc_exit_function (char*, char, char, char, char, int, ...)
+    // void vfc_exit_function (interflop_function_info_t*,
+    //                         interflop_function_signature_t*, void*)
     func = M.getOrInsertFunction(
         "vfc_exit_function",
-        FunctionType::get(Type::getVoidTy(M.getContext()), ArgTypes, true));
+        FunctionType::get(Type::getVoidTy(M.getContext()), ArgTypes, false));
 
     func_exit = cast<Function>(func);
     func_exit->setCallingConv(CallingConv::C);
@@ -300,9 +393,6 @@ struct VfclibFunc : public ModulePass {
     if (M.getFunction("main")) {
       Function *Main = M.getFunction("main");
 
-      ValueToValueMapTy VMap;
-      Function *Clone = CloneFunction(Main, VMap);
-
       DISubprogram *Sub = Main->getSubprogram();
       std::string Name = Sub->getName().str();
       std::string File = Sub->getFilename().str();
@@ -317,35 +407,33 @@ struct VfclibFunc : public ModulePass {
       // Test if the function use double or float
       haveFloatingPointArithmetic(NULL, Main, 0, 0, &use_float, &use_double, M);
 
-      // Delete Main Body
-      Main->deleteBody();
+      // Without floating point values, only the calls of main are
+      // instrumented
+      if (!use_float && !use_double) {
+        OriginalFunctions.push_back(Main);
+      } else {
+        ValueToValueMapTy VMap;
+        Function *Clone = CloneFunction(Main, VMap);
 
-      BasicBlock *block = BasicBlock::Create(M.getContext(), "block", Main);
-      IRBuilder<> Builder(block);
+        // Delete Main Body
+        Main->deleteBody();
 
-      // Create function ID
-      Value *FunctionID = Builder.CreateGlobalStringPtr(FunctionName);
+        BasicBlock *block = BasicBlock::Create(M.getContext(), "block", Main);
 
-      // Constants creation
-      Constant *isLibraryFunction =
-          ConstantInt::get(Type::getInt8Ty(M.getContext()), 0);
-      Constant *isInstrinsicFunction =
-          ConstantInt::get(Type::getInt8Ty(M.getContext()), 0);
-      Constant *haveFloat =
-          ConstantInt::get(Type::getInt8Ty(M.getContext()), use_float);
-      Constant *haveDouble =
-          ConstantInt::get(Type::getInt8Ty(M.getContext()), use_double);
+        // Call-site descriptor
+        Constant *FunctionInfo =
+            getFunctionInfo(M, FunctionName, 0, 0, use_float, use_double);
 
-      // Enter metadata arguments
-      std::vector<Value *> MetaData{FunctionID, isLibraryFunction,
-                                    isInstrinsicFunction, haveFloat,
-                                    haveDouble};
+        Clone->setName(NewName);
 
-      Clone->setName(NewName);
-
-      InstrumentFunction(MetaData, Main, Clone, NULL, block);
+        std::vector<Value *> FunctionArgs;
+        for (auto &args : Main->args()) {
+          FunctionArgs.push_back(&args);
+        }
+        InstrumentFunction(FunctionInfo, FunctionArgs, Clone, block);
 
-      OriginalFunctions.push_back(Clone);
+        OriginalFunctions.push_back(Clone);
+      }
     }
 
     /*************************************************************************
@@ -353,8 +441,6 @@ struct VfclibFunc : public ModulePass {
      *************************************************************************/
     for (auto &F : OriginalFunctions) {
       for (auto &B : (*F)) {
-        IRBuilder<> Builder(&B);
-
         for (auto ii = B.begin(); ii != B.end();) {
           Instruction *pi = &(*ii++);
 
@@ -368,10 +454,6 @@ struct VfclibFunc : public ModulePass {
             std::string File = Loc->getFilename().str();
             std::string Name = demangle(f->getName().str());
             std::string Line = std::to_string(line);
-            std::string NewName = "vfc_" + File + "/" + f->getName().str() +
-                                  "_" + Line + "_" + std::to_string(inst_cpt) +
-                                  "_" + "_hook";
-
             std::string FunctionName = File + "/" + Name + "_" + Line + "_" +
                                        std::to_string(inst_cpt++);
 
@@ -389,44 +471,37 @@ struct VfclibFunc : public ModulePass {
               haveFloatingPointArithmetic(pi, f, is_from_library, is_intrinsic,
                                           &use_float, &use_double, M);
 
-              // Create function ID
-              Value *FunctionID = Builder.CreateGlobalStringPtr(FunctionName);
-
-              // Constants creation
-              Constant *isLibraryFunction = ConstantInt::get(
-                  Type::getInt8Ty(M.getContext()), is_from_library);
-              Constant *isInstrinsicFunction = ConstantInt::get(
-                  Type::getInt8Ty(M.getContext()), is_intrinsic);
-              Constant *haveFloat =
-                  ConstantInt::get(Type::getInt8Ty(M.getContext()), use_float);
-              Constant *haveDouble =
-                  ConstantInt::get(Type::getInt8Ty(M.getContext()), use_double);
-
-              // Enter function arguments
-              std::vector<Value *> MetaData{FunctionID, isLibraryFunction,
-                                            isInstrinsicFunction, haveFloat,
-                                            haveDouble};
-
-              Type *ReturnTy = f->getReturnType();
-              std::vector<Type *> CallTypes;
-              for (auto it = pi->op_begin(); it < pi->op_end() - 1; it++) {
-                CallTypes.push_back(cast<Value>(it)->getType());
+              // Calls without floating point values are left untouched, no
+              // backend acts on them
+              if (!use_float && !use_double) {
+                continue;
               }
 
-              Constant *c = M.getOrInsertFunction(
-                  NewName, FunctionType::get(ReturnTy, CallTypes, false));
-              Function *hook_func = cast<Function>(c);
-
-              hook_func->setAttributes(f->getAttributes());
-              hook_func->setCallingConv(f->getCallingConv());
+              // Call-site descriptor
+              Constant *FunctionInfo =
+                  getFunctionInfo(M, FunctionName, is_from_library,
+                                  is_intrinsic, use_float, use_double);
 
-              BasicBlock *block =
-                  BasicBlock::Create(M.getContext(), "block", hook_func);
-
-              InstrumentFunction(MetaData, hook_func, f, cast<CallInst>(pi),
-                                 block);
-
-              cast<CallInst>(pi)->setCalledFunction(hook_func);
+              CallInst *call = cast<CallInst>(pi);
+              std::vector<Type *> CallTypes;
+              std::vector<Value *> CallArgs;
+              for (auto it = call->op_begin(); it < call->op_end() - 1; it++) {
+                CallTypes.push_back(cast<Value>(it)->getType());
+                CallArgs.push_back(cast<Value>(it));
+              }
+              CallArgs.push_back(FunctionInfo);
+
+              // Replace the call by a call of the hook with the descriptor
+              Function *hook_func = getHook(M, f, CallTypes);
+              CallInst *hook_call =
+                  CallInst::Create(hook_func, CallArgs, "", call);
+              hook_call->setAttributes(call->getAttributes());
+              hook_call->setCallingConv(call->getCallingConv());
+              hook_call->setTailCallKind(call->getTailCallKind());
+              hook_call->setDebugLoc(call->getDebugLoc());
+              hook_call->takeName(call);
+              call->replaceAllUsesWith(hook_call);
+              call->eraseFromParent();
             }
           }
         }
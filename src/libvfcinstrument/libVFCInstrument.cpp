@@ -26,6 +26,7 @@
  ******************************************************************************/
 
 #include "../../config.h"
+#include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
@@ -35,10 +36,18 @@
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 
 #include <fstream>
+#include <map>
 #include <set>
+#include <tuple>
 #include <utility>
 
 #if LLVM_VERSION_MAJOR == 3 && LLVM_VERSION_MINOR <= 6
+#define CREATE_CALL6(func, op1, op2, op3, op4, op5, op6)                       \
+  (Builder.CreateCall(func, {op1, op2, op3, op4, op5, op6}, ""))
+#define CREATE_CALL5(func, op1, op2, op3, op4, op5)                            \
+  (Builder.CreateCall5(func, op1, op2, op3, op4, op5, ""))
+#define CREATE_CALL4(func, op1, op2, op3, op4)                                 \
+  (Builder.CreateCall4(func, op1, op2, op3, op4, ""))
 #define CREATE_CALL3(func, op1, op2, op3)                                      \
   (Builder.CreateCall3(func, op1, op2, op3, ""))
 #define CREATE_CALL2(func, op1, op2) (Builder.CreateCall2(func, op1, op2, ""))
@@ -52,6 +61,12 @@
   M.getOrInsertFunction(name, res, __VA_ARGS__, (Type *)NULL)
 typedef llvm::Constant *_LLVMFunctionType;
 #elif LLVM_VERSION_MAJOR < 5
+#define CREATE_CALL6(func, op1, op2, op3, op4, op5, op6)                       \
+  (Builder.CreateCall(func, {op1, op2, op3, op4, op5, op6}, ""))
+#define CREATE_CALL5(func, op1, op2, op3, op4, op5)                            \
+  (Builder.CreateCall(func, {op1, op2, op3, op4, op5}, ""))
+#define CREATE_CALL4(func, op1, op2, op3, op4)                                 \
+  (Builder.CreateCall(func, {op1, op2, op3, op4}, ""))
 #define CREATE_CALL3(func, op1, op2, op3)                                      \
   (Builder.CreateCall(func, {op1, op2, op3}, ""))
 #define CREATE_CALL2(func, op1, op2) (Builder.CreateCall(func, {op1, op2}, ""))
@@ -60,6 +75,12 @@ typedef llvm::Constant *_LLVMFunctionType;
   M.getOrInsertFunction(name, res, __VA_ARGS__, (Type *)NULL)
 typedef llvm::Constant *_LLVMFunctionType;
 #elif LLVM_VERSION_MAJOR < 9
+#define CREATE_CALL6(func, op1, op2, op3, op4, op5, op6)                       \
+  (Builder.CreateCall(func, {op1, op2, op3, op4, op5, op6}, ""))
+#define CREATE_CALL5(func, op1, op2, op3, op4, op5)                            \
+  (Builder.CreateCall(func, {op1, op2, op3, op4, op5}, ""))
+#define CREATE_CALL4(func, op1, op2, op3, op4)                                 \
+  (Builder.CreateCall(func, {op1, op2, op3, op4}, ""))
 #define CREATE_CALL3(func, op1, op2, op3)                                      \
   (Builder.CreateCall(func, {op1, op2, op3}, ""))
 #define CREATE_CALL2(func, op1, op2) (Builder.CreateCall(func, {op1, op2}, ""))
@@ -68,6 +89,12 @@ typedef llvm::Constant *_LLVMFunctionType;
   M.getOrInsertFunction(name, res, __VA_ARGS__)
 typedef llvm::Constant *_LLVMFunctionType;
 #else
+#define CREATE_CALL6(func, op1, op2, op3, op4, op5, op6)                       \
+  (Builder.CreateCall(func, {op1, op2, op3, op4, op5, op6}, ""))
+#define CREATE_CALL5(func, op1, op2, op3, op4, op5)                            \
+  (Builder.CreateCall(func, {op1, op2, op3, op4, op5}, ""))
+#define CREATE_CALL4(func, op1, op2, op3, op4)                                 \
+  (Builder.CreateCall(func, {op1, op2, op3, op4}, ""))
 #define CREATE_CALL3(func, op1, op2, op3)                                      \
   (Builder.CreateCall(func, {op1, op2, op3}, ""))
 #define CREATE_CALL2(func, op1, op2) (Builder.CreateCall(func, {op1, op2}, ""))
@@ -77,6 +104,12 @@ typedef llvm::Constant *_LLVMFunctionType;
 typedef llvm::FunctionCallee _LLVMFunctionType;
 #endif
 
+#if LLVM_VERSION_MAJOR < 10
+#define SET_ALIGNMENT(v, a) ((v)->setAlignment(a))
+#else
+#define SET_ALIGNMENT(v, a) ((v)->setAlignment(MaybeAlign(a)))
+#endif
+
 using namespace llvm;
 // VfclibInst pass command line arguments
 static cl::opt<std::string>
@@ -120,6 +153,13 @@ struct VfclibInst : public ModulePass {
   std::set<std::string> IncludedFunctionSet;
   std::set<std::string> ExcludedFunctionSet;
 
+  // Stack slots used to pass vectors by reference, indexed by function,
+  // vector type and argument position
+  std::map<std::tuple<Function *, Type *, unsigned>, AllocaInst *> VectorSlots;
+
+  // Strings of the call-site descriptors, shared in the module
+  std::map<std::string, Constant *> Strings;
+
   VfclibInst() : ModulePass(ID) {}
 
   void parseFunctionSetFile(Module &M, cl::opt<std::string> &fileName,
@@ -217,14 +257,143 @@ struct VfclibInst : public ModulePass {
       errs().write_escaped(F.getName()) << '\n';
     }
 
-    bool modified = false;
-
+    // Operations are collected before any change since instrumenting one
+    // splits its basic block and adds a native copy of it
+    std::vector<std::pair<Instruction *, Fops>> WorkList;
     for (Function::iterator bi = F.begin(), be = F.end(); bi != be; ++bi) {
-      modified |= runOnBasicBlock(M, *bi);
+      for (BasicBlock::iterator ii = bi->begin(), ie = bi->end(); ii != ie;
+           ++ii) {
+        Instruction &I = *ii;
+        Fops opCode = mustReplace(I);
+        if (opCode == FOP_IGNORE)
+          continue;
+        WorkList.push_back(std::make_pair(&I, opCode));
+      }
+    }
+
+    bool modified = false;
+    for (auto p : WorkList) {
+      modified |= instrumentOperation(M, p.first, p.second);
     }
     return modified;
   }
 
+  // Returns the stack slot of type T at position index for function F.
+  // Slots are allocated once in the entry block and shared by all the
+  // vector operations of the function since helpers do not keep them.
+  Value *getVectorSlot(Function *F, Type *T, unsigned index) {
+    auto key = std::make_tuple(F, T, index);
+    auto slot = VectorSlots.find(key);
+    if (slot != VectorSlots.end()) {
+      return slot->second;
+    }
+    IRBuilder<> Builder(&*F->getEntryBlock().getFirstInsertionPt());
+    AllocaInst *alloca = Builder.CreateAlloca(T);
+    VectorSlots[key] = alloca;
+    return alloca;
+  }
+
+  // Returns a pointer to the characters of a global string
+  Constant *getString(Module &M, StringRef str) {
+    auto s = Strings.find(str.str());
+    if (s != Strings.end()) {
+      return s->second;
+    }
+    Constant *data = ConstantDataArray::getString(M.getContext(), str);
+    GlobalVariable *gv = new GlobalVariable(
+        M, data->getType(), true, GlobalValue::PrivateLinkage, data, ".str");
+    Constant *zero = ConstantInt::get(Type::getInt32Ty(M.getContext()), 0);
+    Constant *indices[] = {zero, zero};
+    Constant *ptr =
+        ConstantExpr::getGetElementPtr(data->getType(), gv, indices);
+    Strings[str.str()] = ptr;
+    return ptr;
+  }
+
+  // Returns the descriptor of the call site of the operation I, emitted in
+  // the vfc_callsites section. vfcwrapper numbers the call sites by their
+  // position in the section, the layout must match its vfc_callsite_t.
+  Constant *getCallSite(Module &M, Instruction *I, Fops opCode, Type *baseType,
+                        unsigned size) {
+    LLVMContext &C = M.getContext();
+    Type *strType = Type::getInt8PtrTy(C);
+    StructType *siteType = StructType::get(
+        C, {strType, strType, Type::getInt32Ty(C), Type::getInt16Ty(C),
+            Type::getInt8Ty(C), Type::getInt8Ty(C)});
+
+    // The line is only known when the module has debug information
+    std::string file = M.getSourceFileName();
+    unsigned line = 0;
+    const DebugLoc &loc = I->getDebugLoc();
+    if (loc) {
+      line = loc.getLine();
+      if (DIScope *scope = dyn_cast<DIScope>(loc.getScope())) {
+        file = scope->getFilename().str();
+      }
+    }
+
+    Constant *fields[] = {
+        getString(M, file),
+        getString(M, I->getParent()->getParent()->getName()),
+        ConstantInt::get(Type::getInt32Ty(C), line),
+        ConstantInt::get(Type::getInt16Ty(C), size),
+        ConstantInt::get(Type::getInt8Ty(C), opCode),
+        ConstantInt::get(Type::getInt8Ty(C), baseType->isDoubleTy())};
+    GlobalVariable *site = new GlobalVariable(
+        M, siteType, true, GlobalValue::PrivateLinkage,
+        ConstantStruct::get(siteType, fields), "vfc_callsite");
+    site->setSection("vfc_callsites");
+    // Without an explicit alignment, large globals may be padded to 16 bytes
+    SET_ALIGNMENT(site, 8);
+    return site;
+  }
+
+  // Vectors wider than 128 bits are passed by reference to a width-generic
+  // helper _nx<type><op> taking the number of elements. This supports any
+  // width and avoids passing AVX vectors by value to vfcwrapper, whose ABI
+  // depends on the target features it is compiled with.
+  Value *replaceWithGenericVectorCall(Module &M, Instruction *I, Fops opCode,
+                                      std::string mcaFunctionName,
+                                      Type *baseType, unsigned size,
+                                      Constant *site) {
+    IRBuilder<> Builder(I);
+    Function *F = I->getParent()->getParent();
+
+    Type *opType = I->getOperand(0)->getType();
+    Type *resType = opType;
+    if (opCode == FOP_CMP) {
+      resType = VectorType::get(Builder.getInt32Ty(), size);
+    }
+    Type *ptrType = PointerType::getUnqual(baseType);
+    Type *resPtrType = PointerType::getUnqual(resType->getScalarType());
+
+    Value *a = getVectorSlot(F, opType, 0);
+    Value *b = getVectorSlot(F, opType, 1);
+    Value *c = getVectorSlot(F, resType, 2);
+    Builder.CreateStore(I->getOperand(0), a);
+    Builder.CreateStore(I->getOperand(1), b);
+    Value *ptrA = Builder.CreateBitCast(a, ptrType);
+    Value *ptrB = Builder.CreateBitCast(b, ptrType);
+    Value *ptrC = Builder.CreateBitCast(c, resPtrType);
+
+    if (opCode == FOP_CMP) {
+      FCmpInst *FCI = static_cast<FCmpInst *>(I);
+      _LLVMFunctionType hookFunc = GET_OR_INSERT_FUNCTION(
+          M, mcaFunctionName, Builder.getVoidTy(), Builder.getInt32Ty(),
+          Builder.getInt32Ty(), ptrType, ptrType, resPtrType,
+          site->getType());
+      CREATE_CALL6(hookFunc, Builder.getInt32(FCI->getPredicate()),
+                   Builder.getInt32(size), ptrA, ptrB, ptrC, site);
+      return Builder.CreateIntCast(Builder.CreateLoad(c), I->getType(), true);
+    } else {
+      _LLVMFunctionType hookFunc = GET_OR_INSERT_FUNCTION(
+          M, mcaFunctionName, Builder.getVoidTy(), Builder.getInt32Ty(),
+          ptrType, ptrType, ptrType, site->getType());
+      CREATE_CALL5(hookFunc, Builder.getInt32(size), ptrA, ptrB, ptrC, site);
+      return Builder.CreateLoad(c);
+    }
+  }
+
   Value *replaceWithMCACall(Module &M, Instruction *I, Fops opCode) {
     IRBuilder<> Builder(I);
 
@@ -242,15 +411,6 @@ struct VfclibInst : public ModulePass {
       VectorType *t = static_cast<VectorType *>(opType);
       baseType = t->getElementType();
       size = t->getNumElements();
-
-      if (size == 2) {
-        vectorName = "2x";
-      } else if (size == 4) {
-        vectorName = "4x";
-      } else {
-        errs() << "Unsuported vector size: " << size << "\n";
-        return nullptr;
-      }
     }
 
     // Check the type of the operation
@@ -263,6 +423,19 @@ struct VfclibInst : public ModulePass {
       return nullptr;
     }
 
+    Constant *site = getCallSite(M, I, opCode, baseType, size);
+
+    // Vectors that fit in 128 bits are passed by value to the _2x and _4x
+    // helpers, the others go through the width-generic _nx helpers
+    if (size > 1) {
+      if (size == 2 || (size == 4 && baseType->isFloatTy())) {
+        vectorName = std::to_string(size) + "x";
+      } else {
+        return replaceWithGenericVectorCall(
+            M, I, opCode, "_nx" + baseTypeName + opName, baseType, size, site);
+      }
+    }
+
     // Build name of the helper function in vfcwrapper
     std::string mcaFunctionName = "_" + vectorName + baseTypeName + opName;
 
@@ -275,15 +448,17 @@ struct VfclibInst : public ModulePass {
       if (size > 1) {
         res = VectorType::get(res, size);
       }
-      _LLVMFunctionType hookFunc = GET_OR_INSERT_FUNCTION(
-          M, mcaFunctionName, res, Builder.getInt32Ty(), opType, opType);
-      newInst = CREATE_CALL3(hookFunc, Builder.getInt32(FCI->getPredicate()),
-                             FCI->getOperand(0), FCI->getOperand(1));
+      _LLVMFunctionType hookFunc =
+          GET_OR_INSERT_FUNCTION(M, mcaFunctionName, res, Builder.getInt32Ty(),
+                                 opType, opType, site->getType());
+      newInst = CREATE_CALL4(hookFunc, Builder.getInt32(FCI->getPredicate()),
+                             FCI->getOperand(0), FCI->getOperand(1), site);
       newInst = Builder.CreateIntCast(newInst, retType, true);
     } else {
-      _LLVMFunctionType hookFunc =
-          GET_OR_INSERT_FUNCTION(M, mcaFunctionName, retType, opType, opType);
-      newInst = CREATE_CALL2(hookFunc, I->getOperand(0), I->getOperand(1));
+      _LLVMFunctionType hookFunc = GET_OR_INSERT_FUNCTION(
+          M, mcaFunctionName, retType, opType, opType, site->getType());
+      newInst =
+          CREATE_CALL3(hookFunc, I->getOperand(0), I->getOperand(1), site);
     }
 
     return newInst;
@@ -312,31 +487,49 @@ struct VfclibInst : public ModulePass {
     }
   }
 
-  bool runOnBasicBlock(Module &M, BasicBlock &B) {
-    bool modified = false;
-    std::set<std::pair<Instruction *, Fops>> WorkList;
-    for (BasicBlock::iterator ii = B.begin(), ie = B.end(); ii != ie; ++ii) {
-      Instruction &I = *ii;
-      Fops opCode = mustReplace(I);
-      if (opCode == FOP_IGNORE)
-        continue;
-      WorkList.insert(std::make_pair(&I, opCode));
-    }
-
-    for (auto p : WorkList) {
-      Instruction *I = p.first;
-      Fops opCode = p.second;
-      if (VfclibInstVerbose)
-        errs() << "Instrumenting" << *I << '\n';
-      Value *value = replaceWithMCACall(M, I, opCode);
-      if (value != nullptr) {
-        BasicBlock::iterator ii(I);
-        ReplaceInstWithValue(B.getInstList(), ii, value);
-      }
-      modified = true;
+  // Replaces the operation I with
+  //
+  //   if (vfc_instrumentation_enabled) r = <call to the vfcwrapper helper>
+  //   else                              r = <native operation>
+  //
+  // so that disabling the instrumentation at runtime costs one load and one
+  // predictable branch per operation instead of a call
+  bool instrumentOperation(Module &M, Instruction *I, Fops opCode) {
+    if (VfclibInstVerbose)
+      errs() << "Instrumenting" << *I << '\n';
+
+    Type *baseType = I->getOperand(0)->getType()->getScalarType();
+    if (!baseType->isFloatTy() && !baseType->isDoubleTy()) {
+      errs() << "Unsupported operand type: " << *I->getOperand(0)->getType()
+             << "\n";
+      return true;
     }
 
-    return modified;
+    IRBuilder<> Builder(I);
+    Constant *flag =
+        M.getOrInsertGlobal("vfc_instrumentation_enabled", Builder.getInt8Ty());
+    Value *enabled = Builder.CreateICmpNE(Builder.CreateLoad(flag),
+                                         Builder.getInt8(0));
+
+    Instruction *thenTerm, *elseTerm;
+    SplitBlockAndInsertIfThenElse(enabled, I, &thenTerm, &elseTerm);
+
+    // The helper call is built in place of a copy of I in the then block
+    Instruction *instrumented = I->clone();
+    instrumented->insertBefore(thenTerm);
+    Value *value = replaceWithMCACall(M, instrumented, opCode);
+    instrumented->eraseFromParent();
+
+    Instruction *native = I->clone();
+    native->insertBefore(elseTerm);
+
+    PHINode *phi = PHINode::Create(I->getType(), 2, "", I);
+    phi->addIncoming(value, thenTerm->getParent());
+    phi->addIncoming(native, elseTerm->getParent());
+    I->replaceAllUsesWith(phi);
+    I->eraseFromParent();
+
+    return true;
   }
 };
 } // namespace
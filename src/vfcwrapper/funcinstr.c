@@ -20,149 +20,153 @@
  *                                                                            *
  ******************************************************************************/
 
-#define _VFC_CALL_STACK_MAXSIZE 4096
+#define _VFC_CALL_STACK_INITIAL_SIZE 256
 
 /************************************************************
- *                       Hash Functions                     *
+ *                     Function Table                       *
  ************************************************************/
-vfc_hashmap_t _vfc_func_map;
 
-// Add a function in the hash table
-interflop_function_info_t *
-vfc_func_table_add(interflop_function_info_t function) {
-  size_t key = vfc_hashmap_str_function(function.id);
+/* The function instrumentation pass emits an interflop_function_info_t for
+ * each instrumented call site in the vfc_functions section. The linker
+ * gathers them between __start_vfc_functions and __stop_vfc_functions. */
+extern interflop_function_info_t __start_vfc_functions[]
+    __attribute__((weak, visibility("hidden")));
+extern interflop_function_info_t __stop_vfc_functions[]
+    __attribute__((weak, visibility("hidden")));
 
-  interflop_function_info_t *ptr =
-      (interflop_function_info_t *)malloc(sizeof(interflop_function_info_t));
-
-  (*ptr) = function;
-
-  vfc_hashmap_insert(_vfc_func_map, key, (void *)ptr);
-
-  return ptr;
-}
-
-// Search a function in the hash table
-interflop_function_info_t *vfc_func_table_get(const char *id) {
-  size_t key = vfc_hashmap_str_function(id);
-
-  return vfc_hashmap_get(_vfc_func_map, key);
-}
+#define vfc_func_table_count()                                                 \
+  ((size_t)(__stop_vfc_functions - __start_vfc_functions))
 
 // Print the table
 void _vfc_func_table_print(FILE *f) {
-  for (int ii = 0; ii < _vfc_func_map->capacity; ii++) {
-    if (get_value_at(_vfc_func_map->items, ii) != 0 &&
-        get_value_at(_vfc_func_map->items, ii) != 0) {
-      interflop_function_info_t *function =
-          (interflop_function_info_t *)get_value_at(_vfc_func_map->items, ii);
-      fprintf(f, "%s\t%hd\t%hd\t%hd\t%hd\n", function->id,
-              function->isLibraryFunction, function->isIntrinsicFunction,
-              function->useFloat, function->useDouble);
-    }
+  for (size_t i = 0; i < vfc_func_table_count(); i++) {
+    interflop_function_info_t *function = &__start_vfc_functions[i];
+    fprintf(f, "%s\t%hd\t%hd\t%hd\t%hd\n", function->id,
+            function->isLibraryFunction, function->isIntrinsicFunction,
+            function->useFloat, function->useDouble);
   }
 }
 
-void vfc_func_table_init() { _vfc_func_map = vfc_hashmap_create(); }
-
-void vfc_func_table_quit() {
-  vfc_hashmap_free(_vfc_func_map);
-
-  vfc_hashmap_destroy(_vfc_func_map);
-}
-
 /************************************************************
  *                       Call Stack                         *
  ************************************************************/
-static interflop_function_stack_t _vfc_call_stack = {NULL,
-                                                     _VFC_CALL_STACK_MAXSIZE};
-
-// Initialize the call stack
-void vfc_call_stack_init() {
-  _vfc_call_stack.array =
-      malloc(_VFC_CALL_STACK_MAXSIZE * sizeof(interflop_function_info_t *));
-  _vfc_call_stack.array[--_vfc_call_stack.top] = NULL;
+
+/* Each thread has its own call stack. The array grows downwards: the called
+ * function is at array[top], its caller at array[top + 1] and the bottom of
+ * the stack holds NULL. The stack starts in thread-local storage and is moved
+ * to the heap, in an array twice as large, each time it is full. It returns
+ * to thread-local storage once empty, so that a thread ending with an empty
+ * stack leaves no memory behind. */
+static __thread interflop_function_info_t
+    *_vfc_call_stack_local[_VFC_CALL_STACK_INITIAL_SIZE];
+static __thread interflop_function_stack_t _vfc_call_stack = {NULL, 0};
+static __thread long int _vfc_call_stack_size = 0;
+
+// Use the thread-local array as an empty call stack
+static void vfc_call_stack_reset() {
+  _vfc_call_stack.array = _vfc_call_stack_local;
+  _vfc_call_stack_size = _VFC_CALL_STACK_INITIAL_SIZE;
+  _vfc_call_stack.top = _vfc_call_stack_size - 1;
+  _vfc_call_stack.array[_vfc_call_stack.top] = NULL;
+}
+
+// Initialize the call stack of the thread, or double the size of a full one
+static void vfc_call_stack_grow() {
+  if (_vfc_call_stack.array == NULL) {
+    vfc_call_stack_reset();
+    return;
+  }
+
+  const long int size = 2 * _vfc_call_stack_size;
+  interflop_function_info_t **array =
+      malloc(size * sizeof(interflop_function_info_t *));
+  if (array == NULL) {
+    logger_error("Call stack can not grow to %ld functions\n", size);
+  }
+
+  // the entries keep their distance to the bottom of the stack
+  memcpy(array + _vfc_call_stack_size, _vfc_call_stack.array,
+         _vfc_call_stack_size * sizeof(interflop_function_info_t *));
+  if (_vfc_call_stack.array != _vfc_call_stack_local) {
+    free(_vfc_call_stack.array);
+  }
+  _vfc_call_stack.array = array;
+  _vfc_call_stack.top += _vfc_call_stack_size;
+  _vfc_call_stack_size = size;
 }
 
 // Push a function in the call stack
-void vfc_call_stack_push(interflop_function_info_t *function) {
+static inline void vfc_call_stack_push(interflop_function_info_t *function) {
   if (_vfc_call_stack.top == 0) {
-    logger_error("Call stack is full, it max size is %zu\n",
-                 _VFC_CALL_STACK_MAXSIZE);
-    return;
+    vfc_call_stack_grow();
   }
 
   _vfc_call_stack.array[--_vfc_call_stack.top] = function;
 }
 
 // Remove a function in the call stack
-interflop_function_info_t *vfc_call_stack_pop() {
-  if (_vfc_call_stack.top < _VFC_CALL_STACK_MAXSIZE)
-    return _vfc_call_stack.array[_vfc_call_stack.top++];
+static inline interflop_function_info_t *vfc_call_stack_pop() {
+  if (_vfc_call_stack.top >= _vfc_call_stack_size - 1)
+    return NULL;
+
+  interflop_function_info_t *function =
+      _vfc_call_stack.array[_vfc_call_stack.top++];
+
+  if (_vfc_call_stack.top == _vfc_call_stack_size - 1 &&
+      _vfc_call_stack.array != _vfc_call_stack_local) {
+    free(_vfc_call_stack.array);
+    vfc_call_stack_reset();
+  }
 
-  return NULL;
+  return function;
 }
 
-// Print the call stack
+// Print the call stack of the thread
 void vfc_call_stack_print(FILE *f) {
-  for (int i = _VFC_CALL_STACK_MAXSIZE - 2; i >= _vfc_call_stack.top; i--)
+  for (long int i = _vfc_call_stack_size - 2; i >= _vfc_call_stack.top; i--)
     fprintf(f, "%s/", _vfc_call_stack.array[i]->id);
   fprintf(f, "\n");
 }
 
-// Free the call stack
-void vfc_call_stack_free() { free(_vfc_call_stack.array); }
+// Free the call stack of the thread
+void vfc_call_stack_free() {
+  if (_vfc_call_stack.array != _vfc_call_stack_local) {
+    free(_vfc_call_stack.array);
+  }
+  _vfc_call_stack.array = NULL;
+  _vfc_call_stack.top = 0;
+  _vfc_call_stack_size = 0;
+}
 
 /************************************************************
  *                  Enter and Exit functions                *
  ************************************************************/
 
-// Function called before each function's call of the code
-void vfc_enter_function(char *func_name, char isLibraryFunction,
-                        char isIntrinsicFunction, char useFloat, char useDouble,
-                        int n, ...) {
-  // Get a pointer to the function if she is in the table
-  interflop_function_info_t *function = vfc_func_table_get(func_name);
-
-  if (function == NULL) {
-    interflop_function_info_t f = {func_name, isLibraryFunction,
-                                   isIntrinsicFunction, useFloat, useDouble};
-    function = vfc_func_table_add(f);
-  }
-
+// Function called before each function's call of the code, values holds the
+// floating point arguments described by signature
+void vfc_enter_function(interflop_function_info_t *function,
+                        const interflop_function_signature_t *signature,
+                        void *values) {
   vfc_call_stack_push(function);
 
-  if (useFloat || useDouble) {
-    va_list ap;
-    // n is the number of arguments intercepted, each argument
-    // is represented by a type ID and a pointer
-    va_start(ap, n * 2);
-
+  if (function->useFloat || function->useDouble) {
     for (int i = 0; i < loaded_backends; i++)
       if (backends[i].interflop_enter_function)
-        backends[i].interflop_enter_function(&_vfc_call_stack, contexts[i], n,
-                                             ap);
-
-    va_end(ap);
+        backends[i].interflop_enter_function(&_vfc_call_stack, contexts[i],
+                                             signature, values);
   }
 }
 
-// Function called after each function's call of the code
-void vfc_exit_function(char *func_name, char isLibraryFunction,
-                       char isIntrinsicFunction, char useFloat, char useDouble,
-                       int n, ...) {
-  if (useFloat || useDouble) {
-    va_list ap;
-    // n is the number of arguments intercepted, each argument
-    // is represented by a type ID and a pointer
-    va_start(ap, n * 2);
-
+// Function called after each function's call of the code, values holds the
+// floating point return value described by signature
+void vfc_exit_function(interflop_function_info_t *function,
+                       const interflop_function_signature_t *signature,
+                       void *values) {
+  if (function->useFloat || function->useDouble) {
     for (int i = 0; i < loaded_backends; i++)
       if (backends[i].interflop_exit_function)
-        backends[i].interflop_exit_function(&_vfc_call_stack, contexts[i], n,
-                                            ap);
-
-    va_end(ap);
+        backends[i].interflop_exit_function(&_vfc_call_stack, contexts[i],
+                                            signature, values);
   }
 
   vfc_call_stack_pop();
@@ -172,19 +176,7 @@ void vfc_exit_function(char *func_name, char isLibraryFunction,
  *                   Init and Quit functions                *
  ************************************************************/
 
-void vfc_init_func_inst() {
-  // Initialize the call stack
-  vfc_call_stack_init();
-
-  // Initialize the hashmap
-  vfc_func_table_init();
-}
-
 void vfc_quit_func_inst() {
-
   // Free the call stack
   vfc_call_stack_free();
-
-  // Free the hashmap
-  vfc_func_table_quit();
 }
\ No newline at end of file
@@ -28,13 +28,14 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <math.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
-#include <sys/wait.h>
 #include <unistd.h>
 
 #include "interflop.h"
@@ -52,7 +53,6 @@
 #endif
 
 typedef double double2 __attribute__((ext_vector_type(2)));
-typedef double double4 __attribute__((ext_vector_type(4)));
 typedef float float2 __attribute__((ext_vector_type(2)));
 typedef float float4 __attribute__((ext_vector_type(4)));
 typedef int int2 __attribute__((ext_vector_type(2)));
@@ -61,6 +61,43 @@ typedef int int4 __attribute__((ext_vector_type(4)));
 typedef struct interflop_backend_interface_t (*interflop_init_t)(
     int argc, char **argv, void **context);
 
+#ifdef VFC_INLINE_BACKEND
+/* With verificarlo --inline-backend, the backend is linked in the program
+ * instead of being loaded with dlopen. VFC_INLINE_BACKEND is the name of its
+ * shared library, which VFC_BACKENDS must use to pass options to it. */
+struct interflop_backend_interface_t interflop_init(int argc, char **argv,
+                                                    void **context);
+#endif
+
+/* Call sites
+ *
+ * The instrumentation pass emits a descriptor for each instrumented operation
+ * in the vfc_callsites section and passes it to the wrappers. The linker
+ * gathers the descriptors of all the modules between __start_vfc_callsites
+ * and __stop_vfc_callsites, so the position of a descriptor in the section is
+ * a dense call-site id. */
+typedef struct {
+  const char *file;
+  const char *function;
+  uint32_t line;     /* 0 without debug information */
+  uint16_t width;    /* 1 for scalar operations */
+  uint8_t operation; /* index in vfc_callsite_operations */
+  uint8_t precision; /* enum FTYPES */
+} vfc_callsite_t;
+
+extern const vfc_callsite_t __start_vfc_callsites[]
+    __attribute__((weak, visibility("hidden")));
+extern const vfc_callsite_t __stop_vfc_callsites[]
+    __attribute__((weak, visibility("hidden")));
+
+#define vfc_callsites_count()                                                  \
+  ((size_t)(__stop_vfc_callsites - __start_vfc_callsites))
+#define vfc_callsite_id(site) ((size_t)((site)-__start_vfc_callsites))
+
+static const char *vfc_callsite_operations[] = {"add", "sub", "mul", "div",
+                                                "cmp"};
+static const char *vfc_callsite_precisions[] = {"float", "double"};
+
 #define MAX_BACKENDS 16
 #define MAX_ARGS 256
 
@@ -69,6 +106,122 @@ void *contexts[MAX_BACKENDS];
 unsigned char loaded_backends = 0;
 unsigned char already_initialized = 0;
 
+/* Instrumented operations run the native operation instead of calling the
+ * wrappers when vfc_instrumentation_enabled is zero */
+unsigned char vfc_instrumentation_enabled = 1;
+
+/* Dispatch tables
+ *
+ * For each operation, vfc_init registers once, in loading order, the hooks
+ * of the backends that implement it together with their contexts. The
+ * wrappers then call the registered hooks directly; the one and two backends
+ * cases are unrolled so that the hot path has neither a loop over the loaded
+ * backends nor a NULL check. */
+#define define_dispatch_table(precision, operation, ...)                       \
+  struct {                                                                     \
+    unsigned char size;                                                        \
+    struct {                                                                   \
+      void (*hook)(__VA_ARGS__);                                               \
+      void *context;                                                           \
+    } backends[MAX_BACKENDS];                                                  \
+  } dispatch_##operation##_##precision
+
+/* Arithmetic tables also hold the optional vector hooks */
+#define define_arithmetic_dispatch_table(precision, operation)                 \
+  struct {                                                                     \
+    unsigned char size;                                                        \
+    struct {                                                                   \
+      void (*hook)(precision, precision, precision *, void *);                 \
+      void (*vec_hook)(int, const precision *, const precision *, precision *, \
+                       void *);                                                \
+      void *context;                                                           \
+    } backends[MAX_BACKENDS];                                                  \
+  } dispatch_##operation##_##precision
+
+define_arithmetic_dispatch_table(float, add);
+define_arithmetic_dispatch_table(float, sub);
+define_arithmetic_dispatch_table(float, mul);
+define_arithmetic_dispatch_table(float, div);
+define_arithmetic_dispatch_table(double, add);
+define_arithmetic_dispatch_table(double, sub);
+define_arithmetic_dispatch_table(double, mul);
+define_arithmetic_dispatch_table(double, div);
+define_dispatch_table(float, cmp, enum FCMP_PREDICATE, float, float, int *,
+                      void *);
+define_dispatch_table(double, cmp, enum FCMP_PREDICATE, double, double, int *,
+                      void *);
+
+/* Registers the backends implementing an operation in its dispatch table */
+#define register_dispatch(precision, operation)                                \
+  do {                                                                         \
+    dispatch_##operation##_##precision.size = 0;                               \
+    for (unsigned char i = 0; i < loaded_backends; i++) {                      \
+      if (backends[i].interflop_##operation##_##precision) {                   \
+        unsigned char n = dispatch_##operation##_##precision.size++;           \
+        dispatch_##operation##_##precision.backends[n].hook =                  \
+            backends[i].interflop_##operation##_##precision;                   \
+        dispatch_##operation##_##precision.backends[n].context = contexts[i];  \
+      }                                                                        \
+    }                                                                          \
+  } while (0)
+
+/* Registers the vector hooks of an arithmetic operation, it must follow
+ * register_dispatch since both walk the backends in the same order */
+#define register_vector_dispatch(precision, operation)                         \
+  do {                                                                         \
+    unsigned char n = 0;                                                       \
+    for (unsigned char i = 0; i < loaded_backends; i++) {                      \
+      if (backends[i].interflop_##operation##_##precision) {                   \
+        dispatch_##operation##_##precision.backends[n++].vec_hook =            \
+            backends[i].interflop_##operation##_##precision##_vec;             \
+      }                                                                        \
+    }                                                                          \
+  } while (0)
+
+#ifdef VFC_INLINE_BACKEND
+/* Calls the hook of the inlined backend, which is the only one loaded */
+#define dispatch(precision, operation, ...)                                    \
+  do {                                                                         \
+    const typeof(dispatch_##operation##_##precision) *d =                      \
+        &dispatch_##operation##_##precision;                                   \
+    d->backends[0].hook(__VA_ARGS__, d->backends[0].context);                  \
+  } while (0)
+#else
+/* Calls the registered hooks of an operation, the context is appended to the
+ * arguments */
+#define dispatch(precision, operation, ...)                                    \
+  do {                                                                         \
+    const typeof(dispatch_##operation##_##precision) *d =                      \
+        &dispatch_##operation##_##precision;                                   \
+    if (__builtin_expect(d->size == 1, 1)) {                                   \
+      d->backends[0].hook(__VA_ARGS__, d->backends[0].context);                \
+    } else if (d->size == 2) {                                                 \
+      d->backends[0].hook(__VA_ARGS__, d->backends[0].context);                \
+      d->backends[1].hook(__VA_ARGS__, d->backends[1].context);                \
+    } else {                                                                   \
+      for (unsigned char i = 0; i < d->size; i++)                              \
+        d->backends[i].hook(__VA_ARGS__, d->backends[i].context);              \
+    }                                                                          \
+  } while (0)
+#endif
+
+/* Calls the registered hooks of an arithmetic operation on arrays of width
+ * elements. Backends without vector hooks get one scalar call per element */
+#define vector_dispatch(precision, operation, width, a, b, c)                  \
+  do {                                                                         \
+    const typeof(dispatch_##operation##_##precision) *d =                      \
+        &dispatch_##operation##_##precision;                                   \
+    for (unsigned char i = 0; i < d->size; i++) {                              \
+      if (d->backends[i].vec_hook) {                                           \
+        d->backends[i].vec_hook(width, a, b, c, d->backends[i].context);       \
+      } else {                                                                 \
+        for (int j = 0; j < width; j++)                                        \
+          d->backends[i].hook((a)[j], (b)[j], &(c)[j],                         \
+                              d->backends[i].context);                         \
+      }                                                                        \
+    }                                                                          \
+  } while (0)
+
 /* Logger functions */
 #undef BACKEND_HEADER
 #define BACKEND_HEADER verificarlo
@@ -82,92 +235,193 @@ static char *dd_generate_path = NULL;
 
 /* Function instrumentation prototypes */
 
-void vfc_init_func_inst();
-
 void vfc_quit_func_inst();
 
-/* Hashmap header */
-
-#define __VFC_HASHMAP_HEADER__
-
-struct vfc_hashmap_st {
-  size_t nbits;
-  size_t mask;
-
-  size_t capacity;
-  size_t *items;
-  size_t nitems;
-  size_t n_deleted_items;
-};
-typedef struct vfc_hashmap_st *vfc_hashmap_t;
-
-// allocate and initialize the map
-vfc_hashmap_t vfc_hashmap_create();
-
-// free the map
-void vfc_hashmap_destroy(vfc_hashmap_t map);
-
-// get the value at an index of a map
-size_t get_value_at(size_t *items, size_t i);
-
-// get the key at an index of a map
-size_t get_key_at(size_t *items, size_t i);
-
-// set the value at an index of a map
-void set_value_at(size_t *items, size_t value, size_t i);
+#ifdef DDEBUG
+/* Delta-debug
+ *
+ * Operations are identified by their call-site id. In generation mode, the
+ * wrappers set the bit of each executed call site in dd_sites and record the
+ * address of the call to report it. In inclusion mode, only the call sites
+ * whose bit is set in dd_sites are instrumented. The bitmap is shared by
+ * all the threads. */
+#define DD_WORD_BITS 64
+
+static uint64_t *dd_sites = NULL;
+static void **dd_addresses = NULL;
+
+#define dd_word(id) (dd_sites[(id) / DD_WORD_BITS])
+#define dd_bit(id) (UINT64_C(1) << ((id) % DD_WORD_BITS))
+#define dd_have(id)                                                            \
+  ((__atomic_load_n(&dd_word(id), __ATOMIC_RELAXED) & dd_bit(id)) != 0)
+
+static void ddebug_init(void) {
+  const size_t n = vfc_callsites_count();
+  dd_sites = calloc(n / DD_WORD_BITS + 1, sizeof(uint64_t));
+  dd_addresses = calloc(n + 1, sizeof(void *));
+  if (dd_sites == NULL || dd_addresses == NULL) {
+    logger_error("ddebug: cannot allocate the call-site bitmap");
+  }
+}
 
-// set the key at an index of a map
-void set_key_at(size_t *items, size_t key, size_t i);
+/* Marks a call site as executed, only the first thread to execute it records
+ * its address */
+static void ddebug_seen(const size_t id, void *addr) {
+  const uint64_t bit = dd_bit(id);
+  if ((__atomic_fetch_or(&dd_word(id), bit, __ATOMIC_RELAXED) & bit) == 0) {
+    __atomic_store_n(&dd_addresses[id], addr, __ATOMIC_RELAXED);
+  }
+}
 
-// insert an element in the map
-void vfc_hashmap_insert(vfc_hashmap_t map, size_t key, void *item);
+/* Reads the call-site ids of the operations to instrument, given after the
+ * '#' that ends each line of the inclusion file */
+static void ddebug_read_inclusion(char *dd_filter_path) {
+  FILE *input = fopen(dd_filter_path, "r");
+  if (input == NULL) {
+    return;
+  }
+  const size_t n = vfc_callsites_count();
+  size_t included = 0;
+  char line[2048];
+  int lineno = 0;
+  while (fgets(line, sizeof line, input)) {
+    lineno++;
+    const char *sharp = strrchr(line, '#');
+    size_t id;
+    if (sharp == NULL || sscanf(sharp, "#%zu", &id) != 1 || id >= n) {
+      logger_error("ddebug: error parsing VFC_DDEBUG_INCLUDE %s at line %d",
+                   dd_filter_path, lineno);
+    }
+    if (!dd_have(id)) {
+      dd_word(id) |= dd_bit(id);
+      included++;
+    }
+  }
+  fclose(input);
+  logger_info("ddebug: only %zu call sites will be instrumented\n", included);
+}
 
-// remove an element of the map
-void vfc_hashmap_remove(vfc_hashmap_t map, size_t key);
+/* Writes the operations executed during the run, one per line in the format
+ * of addr2line -fpaCs followed by their call-site id. The location is read
+ * from the call-site descriptor, without debug information nor external
+ * tools */
+void ddebug_generate_inclusion(char *dd_generate_path) {
+  FILE *output = fopen(dd_generate_path, "w");
+  if (output == NULL) {
+    logger_error("cannot open DDEBUG_GEN file %s", dd_generate_path);
+  }
+  const size_t n = vfc_callsites_count();
+  for (size_t id = 0; id < n; id++) {
+    if (dd_have(id)) {
+      const vfc_callsite_t *site = &__start_vfc_callsites[id];
+      const char *file = strrchr(site->file, '/');
+      file = (file) ? file + 1 : site->file;
+      fprintf(output, "0x%016zx: %s at %s:%" PRIu32 " #%zu\n",
+              (size_t)dd_addresses[id] - CALL_OP_SIZE, site->function, file,
+              site->line, id);
+    }
+  }
+  fclose(output);
+}
+#endif
 
-// test if an element is in the map
-char vfc_hashmap_have(vfc_hashmap_t map, size_t key);
+/* Call-site profile
+ *
+ * With VFC_PROFILE=<file>, the wrappers count the operations of each call
+ * site in per-thread arrays. The arrays are registered in a lock-free list
+ * and merged at exit into <file>, one call site per line by decreasing
+ * count. Operations run natively while the instrumentation is disabled are
+ * not counted. */
+typedef struct vfc_profile_counters {
+  uint64_t *counts;
+  struct vfc_profile_counters *next;
+} vfc_profile_counters_t;
+
+static char *vfc_profile_path = NULL;
+static unsigned char vfc_profiling = 0;
+static vfc_profile_counters_t *vfc_profile_threads = NULL;
+static __thread uint64_t *vfc_profile_counts = NULL;
+static uint64_t *vfc_profile_totals = NULL;
+
+static uint64_t *vfc_profile_thread_init(void) {
+  vfc_profile_counters_t *counters = malloc(sizeof(vfc_profile_counters_t));
+  uint64_t *counts = calloc(vfc_callsites_count() + 1, sizeof(uint64_t));
+  if (counters == NULL || counts == NULL) {
+    logger_error("cannot allocate the call-site profile counters");
+  }
+  counters->counts = counts;
+  counters->next = __atomic_load_n(&vfc_profile_threads, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&vfc_profile_threads, &counters->next,
+                                      counters, true, __ATOMIC_RELEASE,
+                                      __ATOMIC_RELAXED))
+    ;
+  vfc_profile_counts = counts;
+  return counts;
+}
 
-// get an element of the map
-void *vfc_hashmap_get(vfc_hashmap_t map, size_t key);
+static inline void vfc_profile_count(const vfc_callsite_t *site) {
+  uint64_t *counts = vfc_profile_counts;
+  if (__builtin_expect(counts == NULL, 0)) {
+    counts = vfc_profile_thread_init();
+  }
+  counts[vfc_callsite_id(site)]++;
+}
 
-// get the number of elements in the map
-size_t vfc_hashmap_num_items(vfc_hashmap_t map);
+static int vfc_profile_compare(const void *a, const void *b) {
+  const uint64_t count_a = vfc_profile_totals[*(const size_t *)a];
+  const uint64_t count_b = vfc_profile_totals[*(const size_t *)b];
+  return (count_a < count_b) - (count_a > count_b);
+}
 
-// Hash function for strings
-size_t vfc_hashmap_str_function(const char *id);
+static void vfc_profile_write(void) {
+  const size_t n = vfc_callsites_count();
+  uint64_t *totals = calloc(n + 1, sizeof(uint64_t));
+  size_t *ids = malloc((n + 1) * sizeof(size_t));
+  if (totals == NULL || ids == NULL) {
+    logger_error("cannot allocate the call-site profile");
+  }
 
-// Free the hashmap
-void vfc_hashmap_free(vfc_hashmap_t map);
+  /* Merge the counters of all the threads */
+  vfc_profile_counters_t *counters =
+      __atomic_load_n(&vfc_profile_threads, __ATOMIC_ACQUIRE);
+  for (; counters != NULL; counters = counters->next) {
+    for (size_t i = 0; i < n; i++) {
+      totals[i] += counters->counts[i];
+    }
+  }
 
-vfc_hashmap_t dd_must_instrument;
+  size_t sites = 0;
+  uint64_t total = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (totals[i] != 0) {
+      ids[sites++] = i;
+      total += totals[i];
+    }
+  }
+  vfc_profile_totals = totals;
+  qsort(ids, sites, sizeof(size_t), vfc_profile_compare);
 
-void ddebug_generate_inclusion(char *dd_generate_path, vfc_hashmap_t map) {
-  int output = open(dd_generate_path, O_WRONLY | O_CREAT, S_IWUSR | S_IRUSR);
-  if (output == -1) {
-    logger_error("cannot open DDEBUG_GEN file %s", dd_generate_path);
+  FILE *output = fopen(vfc_profile_path, "w");
+  if (output == NULL) {
+    logger_error("cannot open VFC_PROFILE file %s", vfc_profile_path);
   }
-  for (int i = 0; i < map->capacity; i++) {
-    if (get_value_at(map->items, i) != 0 && get_value_at(map->items, i) != 1) {
-      pid_t pid = fork();
-      if (pid == 0) {
-        char addr[19];
-        char executable[64];
-        snprintf(addr, 19, "%p",
-                 (void *)(get_value_at(map->items, i) - CALL_OP_SIZE));
-        snprintf(executable, 64, "/proc/%d/exe", getppid());
-        dup2(output, 1);
-        execlp("addr2line", "/usr/bin/addr2line", "-fpaCs", "-e", executable,
-               addr, NULL);
-        logger_error("error running addr2line");
-      } else {
-        int status;
-        wait(&status);
-        assert(status == 0);
-      }
+  fprintf(output, "# %" PRIu64 " operations in %zu call sites\n", total, sites);
+  fprintf(output, "# id\tcount\toperation\ttype\tlocation\tfunction\n");
+  for (size_t i = 0; i < sites; i++) {
+    const vfc_callsite_t *site = &__start_vfc_callsites[ids[i]];
+    char type[16] = "";
+    if (site->width > 1) {
+      snprintf(type, sizeof(type), "%ux", (unsigned)site->width);
     }
+    fprintf(output, "%zu\t%" PRIu64 "\t%s\t%s%s\t%s:%" PRIu32 "\t%s\n",
+            ids[i], totals[ids[i]], vfc_callsite_operations[site->operation],
+            type, vfc_callsite_precisions[site->precision], site->file,
+            site->line, site->function);
   }
-  close(output);
+  fclose(output);
+
+  free(totals);
+  free(ids);
 }
 
 __attribute__((destructor(0))) static void vfc_atexit(void) {
@@ -177,30 +431,139 @@ __attribute__((destructor(0))) static void vfc_atexit(void) {
     if (backends[i].interflop_exit_function)
       backends[i].interflop_finalize(contexts[i]);
 
+  if (vfc_profiling) {
+    vfc_profile_write();
+  }
+
 #ifdef DDEBUG
   if (dd_generate_path) {
-    ddebug_generate_inclusion(dd_generate_path, dd_must_instrument);
+    ddebug_generate_inclusion(dd_generate_path);
     logger_info("ddebug: generated complete inclusion file at %s\n",
                 dd_generate_path);
   }
-  vfc_hashmap_destroy(dd_must_instrument);
+  free(dd_sites);
+  free(dd_addresses);
 #endif
 
   vfc_quit_func_inst();
 }
 
+/* Instrumentation control
+ *
+ * vfc_region_begin saves the current state and enables the instrumentation
+ * if the region is listed in the comma-separated VFC_REGIONS, or for any
+ * region when it is not set. vfc_region_end restores the saved state. The
+ * state and the stack of regions are shared by all the threads without
+ * synchronization, regions must not begin or end in parallel sections. */
+#define MAX_REGION_DEPTH 64
+
+static unsigned char vfc_region_stack[MAX_REGION_DEPTH];
+static int vfc_region_depth = 0;
+static char *vfc_regions = NULL;
+
+void vfc_instrumentation_enable(void) { vfc_instrumentation_enabled = 1; }
+
+void vfc_instrumentation_disable(void) { vfc_instrumentation_enabled = 0; }
+
+static bool vfc_region_selected(const char *name) {
+  if (vfc_regions == NULL) {
+    return true;
+  }
+  const size_t length = strlen(name);
+  for (const char *r = vfc_regions; r != NULL; r = strchr(r, ',')) {
+    r += (*r == ',');
+    if (strncmp(r, name, length) == 0 && (r[length] == ',' || !r[length])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void vfc_region_begin(const char *name) {
+  if (vfc_region_depth == MAX_REGION_DEPTH) {
+    logger_error("vfc_region_begin: more than %d nested regions",
+                 MAX_REGION_DEPTH);
+  }
+  vfc_region_stack[vfc_region_depth++] = vfc_instrumentation_enabled;
+  if (vfc_region_selected(name)) {
+    vfc_instrumentation_enabled = 1;
+  }
+}
+
+void vfc_region_end(void) {
+  if (vfc_region_depth == 0) {
+    logger_error("vfc_region_end: no region to end");
+  }
+  vfc_instrumentation_enabled = vfc_region_stack[--vfc_region_depth];
+}
+
+/* Operation sampling
+ *
+ * With VFC_SAMPLE_PERIOD=N, one arithmetic operation out of N is sent to the
+ * backends and the others run natively. With VFC_SAMPLE_RATE=p, the interval
+ * between two sampled operations is drawn uniformly in [1, 2/p - 1] and
+ * rounded randomly to an integer, so that its mean is exactly 1/p and a
+ * fraction p of the operations is sampled without following the period of
+ * the loops. Each thread counts down the operations left before the next
+ * sampled one, a new interval is only drawn once the countdown expires. */
+static unsigned char vfc_sampling = 0;
+static uint64_t vfc_sample_period = 0;
+static double vfc_sample_span = 0;
+static uint64_t vfc_sample_threads = 0;
+static __thread uint64_t vfc_sample_countdown = 0;
+static __thread uint64_t vfc_sample_state = 0;
+
+/* OpenMP thread numbers are used when the runtime is loaded */
+extern int omp_get_level(void) __attribute__((weak));
+extern int omp_get_thread_num(void) __attribute__((weak));
+
+/* Index of the thread that seeds its samples: 0 for the main thread, the
+ * OpenMP thread number for the other threads of an outermost parallel region
+ * and 2^32 + n for the n-th other thread starting to sample. Only the last
+ * ones depend on the order in which the threads start. */
+static uint64_t vfc_sample_thread_index(void) {
+  if (syscall(SYS_gettid) == getpid()) {
+    return 0;
+  }
+  if (omp_get_level && omp_get_thread_num && omp_get_level() == 1 &&
+      omp_get_thread_num() != 0) {
+    return omp_get_thread_num();
+  }
+  return (UINT64_C(1) << 32) +
+         __atomic_fetch_add(&vfc_sample_threads, 1, __ATOMIC_RELAXED);
+}
+
+/* Returns a uniform double in [0, 1) drawn with xorshift64*, seeded with the
+ * index of the thread so that the sampled operations of a thread are the same
+ * from one run to another */
+static double vfc_sample_random(void) {
+  uint64_t x = vfc_sample_state;
+  if (x == 0) {
+    x = (vfc_sample_thread_index() + 1) * UINT64_C(0x9E3779B97F4A7C15);
+  }
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  vfc_sample_state = x;
+  return ((x * UINT64_C(0x2545F4914F6CDD1D)) >> 11) * 0x1.0p-53;
+}
+
+static uint64_t vfc_sample_interval(void) {
+  if (vfc_sample_period) {
+    return vfc_sample_period;
+  }
+  /* 1 + u * (2/p - 2) has mean 1/p, adding a second uniform draw before
+   * truncating rounds it up with a probability equal to its fractional part,
+   * which keeps the mean */
+  const double interval = vfc_sample_random() * vfc_sample_span;
+  return 1 + (uint64_t)(interval + vfc_sample_random());
+}
+
 /* Checks that a least one of the loaded backend implements the chosen
  * operation at a given precision */
 #define check_backends_implements(precision, operation)                        \
   do {                                                                         \
-    int res = 0;                                                               \
-    for (unsigned char i = 0; i < loaded_backends; i++) {                      \
-      if (backends[i].interflop_##operation##_##precision) {                   \
-        res = 1;                                                               \
-        break;                                                                 \
-      }                                                                        \
-    }                                                                          \
-    if (res == 0)                                                              \
+    if (dispatch_##operation##_##precision.size == 0)                          \
       logger_error("No backend instruments " #operation " for " #precision     \
                    ".\n"                                                       \
                    "Include one backend in VFC_BACKENDS that provides it");    \
@@ -223,14 +586,56 @@ __attribute__((constructor(0))) static void vfc_init(void) {
     return;
   }
 
-  /* Initialize instumentation */
-  vfc_init_func_inst();
-
   /* Initialize the logger */
   logger_init();
 
+  /* Instrumentation starts disabled with VFC_INSTRUMENTATION_DISABLED */
+  char *disabled_env = getenv("VFC_INSTRUMENTATION_DISABLED");
+  if (disabled_env != NULL && strcasecmp(disabled_env, "True") == 0) {
+    vfc_instrumentation_enabled = 0;
+  }
+  vfc_regions = getenv("VFC_REGIONS");
+
+  /* Call-site profile */
+  vfc_profile_path = getenv("VFC_PROFILE");
+  vfc_profiling = (vfc_profile_path != NULL);
+
+  /* Parse VFC_SAMPLE_PERIOD and VFC_SAMPLE_RATE */
+  char *sample_period_env = getenv("VFC_SAMPLE_PERIOD");
+  char *sample_rate_env = getenv("VFC_SAMPLE_RATE");
+  if (sample_period_env && sample_rate_env) {
+    logger_error("VFC_SAMPLE_PERIOD and VFC_SAMPLE_RATE should not be both "
+                 "defined at the same time");
+  }
+  if (sample_period_env) {
+    char *end;
+    long long period = strtoll(sample_period_env, &end, 10);
+    if (*end != '\0' || period < 1) {
+      logger_error("VFC_SAMPLE_PERIOD must be a positive integer: %s",
+                   sample_period_env);
+    }
+    vfc_sample_period = period;
+    vfc_sampling = (period > 1);
+  }
+  if (sample_rate_env) {
+    char *end;
+    double rate = strtod(sample_rate_env, &end);
+    if (*end != '\0' || !(rate > 0 && rate <= 1)) {
+      logger_error("VFC_SAMPLE_RATE must be in ]0, 1]: %s", sample_rate_env);
+    }
+    vfc_sample_span = 2.0 / rate - 2.0;
+    vfc_sampling = (rate < 1);
+  }
+
   /* Parse VFC_BACKENDS */
   char *vfc_backends = getenv("VFC_BACKENDS");
+#ifdef VFC_INLINE_BACKEND
+  /* Without VFC_BACKENDS, the inlined backend uses its default options */
+  char inline_backend[] = VFC_INLINE_BACKEND;
+  if (vfc_backends == NULL) {
+    vfc_backends = inline_backend;
+  }
+#endif
   if (vfc_backends == NULL) {
     logger_error(
         "VFC_BACKENDS is empty, at least one backend should be provided");
@@ -264,6 +669,25 @@ __attribute__((constructor(0))) static void vfc_init(void) {
     }
     backend_argv[backend_argc] = NULL;
 
+#ifdef VFC_INLINE_BACKEND
+    /* the backend is linked in the program, only its options are parsed */
+    const char *name = strrchr(backend_argv[0], '/');
+    name = (name) ? name + 1 : backend_argv[0];
+    if (strcmp(name, VFC_INLINE_BACKEND) != 0) {
+      logger_error("Cannot load backend %s: the program is compiled with the "
+                   "inlined backend %s",
+                   token, VFC_INLINE_BACKEND);
+    }
+    if (loaded_backends > 0) {
+      logger_error("No other backend can be used with the inlined backend %s",
+                   VFC_INLINE_BACKEND);
+    }
+
+    if (!silent_load)
+      logger_info("loaded inlined backend %s\n", token);
+
+    interflop_init_t handle_init = interflop_init;
+#else
     /* load the backend .so */
     void *handle = dlopen(backend_argv[0], RTLD_NOW);
     if (handle == NULL) {
@@ -285,6 +709,7 @@ __attribute__((constructor(0))) static void vfc_init(void) {
       logger_error("No interflop_init function in backend %s: %s", token,
                    strerror(errno));
     }
+#endif
 
     /* Register backend */
     if (loaded_backends == MAX_BACKENDS) {
@@ -304,6 +729,26 @@ __attribute__((constructor(0))) static void vfc_init(void) {
         "VFC_BACKENDS syntax error: at least one backend should be provided");
   }
 
+  /* Build the dispatch tables */
+  register_dispatch(float, add);
+  register_dispatch(float, sub);
+  register_dispatch(float, mul);
+  register_dispatch(float, div);
+  register_dispatch(float, cmp);
+  register_dispatch(double, add);
+  register_dispatch(double, sub);
+  register_dispatch(double, mul);
+  register_dispatch(double, div);
+  register_dispatch(double, cmp);
+  register_vector_dispatch(float, add);
+  register_vector_dispatch(float, sub);
+  register_vector_dispatch(float, mul);
+  register_vector_dispatch(float, div);
+  register_vector_dispatch(double, add);
+  register_vector_dispatch(double, sub);
+  register_vector_dispatch(double, mul);
+  register_vector_dispatch(double, div);
+
   /* Check that at least one backend implements each required operation */
   check_backends_implements(float, add);
   check_backends_implements(float, sub);
@@ -320,7 +765,6 @@ __attribute__((constructor(0))) static void vfc_init(void) {
 
 #ifdef DDEBUG
   /* Initialize ddebug */
-  dd_must_instrument = vfc_hashmap_create();
   dd_filter_path = getenv("VFC_DDEBUG_INCLUDE");
   dd_generate_path = getenv("VFC_DDEBUG_GEN");
   if (dd_filter_path && dd_generate_path) {
@@ -328,58 +772,64 @@ __attribute__((constructor(0))) static void vfc_init(void) {
         "VFC_DDEBUG_INCLUDE and VFC_DDEBUG_GEN should not be both defined "
         "at the same time");
   }
-  FILE *input = fopen(dd_filter_path, "r");
-  if (input) {
-    void *addr;
-    char line[2048];
-    int lineno = 0;
-    while (fgets(line, sizeof line, input)) {
-      lineno++;
-      if (sscanf(line, "%p", &addr) == 1) {
-        vfc_hashmap_insert(dd_must_instrument, (size_t)addr + CALL_OP_SIZE,
-                           addr + CALL_OP_SIZE);
-      } else {
-        logger_error("ddebug: error parsing VFC_DDEBUG_INCLUDE %s at line %d",
-                     dd_filter_path, lineno);
-      }
-    }
-    logger_info("ddebug: only %zu addresses will be instrumented\n",
-                vfc_hashmap_num_items(dd_must_instrument));
+  ddebug_init();
+  if (dd_filter_path) {
+    ddebug_read_inclusion(dd_filter_path);
   }
 #endif
 }
 
 /* Arithmetic wrappers */
 #ifdef DDEBUG
-/* When delta-debug run flags are passed*/
-#define ddebug(operator)                                                       \
-  void *addr = __builtin_return_address(0);                                    \
+/* When delta-debug run flags are passed, operations that are not in the
+ * inclusion file run the native statement instead */
+#define ddebug_native(native)                                                  \
   if (dd_filter_path) {                                                        \
-    if (!vfc_hashmap_have(dd_must_instrument, (size_t)addr)) {                 \
-      return a operator b;                                                     \
-    } else {                                                                   \
+    if (!dd_have(vfc_callsite_id(site))) {                                     \
+      native;                                                                  \
     }                                                                          \
   } else if (dd_generate_path) {                                               \
-    vfc_hashmap_insert(dd_must_instrument, (size_t)addr, addr);                \
+    const size_t id = vfc_callsite_id(site);                                   \
+    if (!dd_have(id)) {                                                        \
+      ddebug_seen(id, __builtin_return_address(0));                            \
+    }                                                                          \
   }
 
 #else
 /* When delta-debug flags are not passed do nothing */
-#define ddebug(operator)                                                       \
+#define ddebug_native(native)                                                  \
   do {                                                                         \
   } while (0)
 #endif
 
+/* When sampling, operations that are not sampled run the native statement
+ * instead */
+#define sample_native(native)                                                  \
+  if (__builtin_expect(vfc_sampling, 0)) {                                     \
+    if (vfc_sample_countdown > 1) {                                            \
+      vfc_sample_countdown--;                                                  \
+      native;                                                                  \
+    }                                                                          \
+    vfc_sample_countdown = vfc_sample_interval();                              \
+  }
+
+#define ddebug(operator) ddebug_native(return a operator b)
+#define sample(operator) sample_native(return a operator b)
+
+/* Counts the operation in the call-site profile */
+#define profile(site)                                                          \
+  if (__builtin_expect(vfc_profiling, 0)) {                                    \
+    vfc_profile_count(site);                                                   \
+  }
+
 #define define_arithmetic_wrapper(precision, operation, operator)              \
-  precision _##precision##operation(precision a, precision b) {                \
-    precision c = NAN;                                                         \
+  precision _##precision##operation(precision a, precision b,                  \
+                                    const vfc_callsite_t *site) {              \
+    precision c;                                                               \
+    profile(site);                                                             \
     ddebug(operator);                                                          \
-    for (unsigned char i = 0; i < loaded_backends; i++) {                      \
-      if (backends[i].interflop_##operation##_##precision) {                   \
-        backends[i].interflop_##operation##_##precision(a, b, &c,              \
-                                                        contexts[i]);          \
-      }                                                                        \
-    }                                                                          \
+    sample(operator);                                                          \
+    dispatch(precision, operation, a, b, &c);                                  \
     return c;                                                                  \
   }
 
@@ -392,92 +842,107 @@ define_arithmetic_wrapper(double, sub, -);
 define_arithmetic_wrapper(double, mul, *);
 define_arithmetic_wrapper(double, div, /);
 
-int _floatcmp(enum FCMP_PREDICATE p, float a, float b) {
-  int c;
-  for (unsigned int i = 0; i < loaded_backends; i++) {
-    if (backends[i].interflop_cmp_float) {
-      backends[i].interflop_cmp_float(p, a, b, &c, contexts[i]);
-    }
+/* Comparison wrappers, the vector ones compare each element with
+ * precision##_cmp and count one operation for the vector */
+#define define_cmp_wrapper(precision)                                          \
+  static inline int precision##_cmp(enum FCMP_PREDICATE p, precision a,        \
+                                    precision b) {                             \
+    int c;                                                                     \
+    dispatch(precision, cmp, p, a, b, &c);                                     \
+    return c;                                                                  \
+  }                                                                            \
+  int _##precision##cmp(enum FCMP_PREDICATE p, precision a, precision b,       \
+                        const vfc_callsite_t *site) {                          \
+    profile(site);                                                             \
+    return precision##_cmp(p, a, b);                                           \
   }
-  return c;
-}
 
-int _doublecmp(enum FCMP_PREDICATE p, double a, double b) {
-  int c;
-  for (unsigned int i = 0; i < loaded_backends; i++) {
-    if (backends[i].interflop_cmp_double) {
-      backends[i].interflop_cmp_double(p, a, b, &c, contexts[i]);
-    }
-  }
-  return c;
-}
+define_cmp_wrapper(float);
+define_cmp_wrapper(double);
 
 /* Arithmetic vector wrappers */
 
-#define define_2x_wrapper(precision, operation)                                \
-  precision##2 _2x##precision##operation(precision##2 a, precision##2 b) {     \
-    precision##2 c;                                                            \
-    c[0] = _##precision##operation(a[0], b[0]);                                \
-    c[1] = _##precision##operation(a[1], b[1]);                                \
+#define define_vector_wrapper(size, precision, operation, operator)            \
+  precision##size _##size##x##precision##operation(                            \
+      precision##size a, precision##size b, const vfc_callsite_t *site) {      \
+    precision##size c;                                                         \
+    profile(site);                                                             \
+    ddebug(operator);                                                          \
+    sample(operator);                                                          \
+    vector_dispatch(precision, operation, size, (precision *)&a,               \
+                    (precision *)&b, (precision *)&c);                         \
     return c;                                                                  \
   }
 
-#define define_4x_wrapper(precision, operation)                                \
-  precision##4 _4x##precision##operation(precision##4 a, precision##4 b) {     \
-    precision##4 c;                                                            \
-    c[0] = _##precision##operation(a[0], b[0]);                                \
-    c[1] = _##precision##operation(a[1], b[1]);                                \
-    c[2] = _##precision##operation(a[2], b[2]);                                \
-    c[3] = _##precision##operation(a[3], b[3]);                                \
-    return c;                                                                  \
+define_vector_wrapper(2, float, add, +);
+define_vector_wrapper(2, float, sub, -);
+define_vector_wrapper(2, float, mul, *);
+define_vector_wrapper(2, float, div, /);
+define_vector_wrapper(2, double, add, +);
+define_vector_wrapper(2, double, sub, -);
+define_vector_wrapper(2, double, mul, *);
+define_vector_wrapper(2, double, div, /);
+
+define_vector_wrapper(4, float, add, +);
+define_vector_wrapper(4, float, sub, -);
+define_vector_wrapper(4, float, mul, *);
+define_vector_wrapper(4, float, div, /);
+
+/* Width-generic vector wrappers, used for vectors that are not passed by
+ * value to the wrappers above */
+
+#define define_generic_vector_wrapper(precision, operation, operator)          \
+  void _nx##precision##operation(int width, const precision *a,                \
+                                 const precision *b, precision *c,             \
+                                 const vfc_callsite_t *site) {                 \
+    profile(site);                                                             \
+    ddebug_native({                                                            \
+      for (int i = 0; i < width; i++)                                          \
+        c[i] = a[i] operator b[i];                                             \
+      return;                                                                  \
+    });                                                                        \
+    sample_native({                                                            \
+      for (int i = 0; i < width; i++)                                          \
+        c[i] = a[i] operator b[i];                                             \
+      return;                                                                  \
+    });                                                                        \
+    vector_dispatch(precision, operation, width, a, b, c);                     \
   }
 
-define_2x_wrapper(float, add);
-define_2x_wrapper(float, sub);
-define_2x_wrapper(float, mul);
-define_2x_wrapper(float, div);
-define_2x_wrapper(double, add);
-define_2x_wrapper(double, sub);
-define_2x_wrapper(double, mul);
-define_2x_wrapper(double, div);
-
-define_4x_wrapper(float, add);
-define_4x_wrapper(float, sub);
-define_4x_wrapper(float, mul);
-define_4x_wrapper(float, div);
-define_4x_wrapper(double, add);
-define_4x_wrapper(double, sub);
-define_4x_wrapper(double, mul);
-define_4x_wrapper(double, div);
-
-int2 _2xdoublecmp(enum FCMP_PREDICATE p, double2 a, double2 b) {
-  int2 c;
-  c[0] = _doublecmp(p, a[0], b[0]);
-  c[1] = _doublecmp(p, a[1], b[1]);
-  return c;
-}
+define_generic_vector_wrapper(float, add, +);
+define_generic_vector_wrapper(float, sub, -);
+define_generic_vector_wrapper(float, mul, *);
+define_generic_vector_wrapper(float, div, /);
+define_generic_vector_wrapper(double, add, +);
+define_generic_vector_wrapper(double, sub, -);
+define_generic_vector_wrapper(double, mul, *);
+define_generic_vector_wrapper(double, div, /);
+
+#define define_vector_cmp_wrapper(size, precision)                             \
+  int##size _##size##x##precision##cmp(enum FCMP_PREDICATE p,                  \
+                                       precision##size a, precision##size b,   \
+                                       const vfc_callsite_t *site) {           \
+    int##size c;                                                               \
+    profile(site);                                                             \
+    for (int i = 0; i < size; i++)                                             \
+      c[i] = precision##_cmp(p, a[i], b[i]);                                   \
+    return c;                                                                  \
+  }
 
-int2 _2xfloatcmp(enum FCMP_PREDICATE p, float2 a, float2 b) {
-  int2 c;
-  c[0] = _floatcmp(p, a[0], b[0]);
-  c[1] = _floatcmp(p, a[1], b[1]);
-  return c;
-}
+define_vector_cmp_wrapper(2, double);
+define_vector_cmp_wrapper(2, float);
+define_vector_cmp_wrapper(4, float);
 
-int4 _4xdoublecmp(enum FCMP_PREDICATE p, double4 a, double4 b) {
-  int4 c;
-  c[0] = _doublecmp(p, a[0], b[0]);
-  c[1] = _doublecmp(p, a[1], b[1]);
-  c[2] = _doublecmp(p, a[2], b[2]);
-  c[3] = _doublecmp(p, a[3], b[3]);
-  return c;
+void _nxdoublecmp(enum FCMP_PREDICATE p, int width, const double *a,
+                  const double *b, int *c, const vfc_callsite_t *site) {
+  profile(site);
+  for (int i = 0; i < width; i++)
+    c[i] = double_cmp(p, a[i], b[i]);
 }
 
-int4 _4xfloatcmp(enum FCMP_PREDICATE p, float4 a, float4 b) {
-  int4 c;
-  c[0] = _floatcmp(p, a[0], b[0]);
-  c[1] = _floatcmp(p, a[1], b[1]);
-  c[2] = _floatcmp(p, a[2], b[2]);
-  c[3] = _floatcmp(p, a[3], b[3]);
-  return c;
+void _nxfloatcmp(enum FCMP_PREDICATE p, int width, const float *a,
+                 const float *b, int *c, const vfc_callsite_t *site) {
+  profile(site);
+  for (int i = 0; i < width; i++)
+    c[i] = float_cmp(p, a[i], b[i]);
 }
@@ -0,0 +1,53 @@
+/*****************************************************************************
+ *                                                                           *
+ *  This file is part of Verificarlo.                                        *
+ *                                                                           *
+ *  Copyright (c) 2015-2020                                                  *
+ *     Verificarlo contributors                                              *
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *
+ *     CMLA, Ecole Normale Superieure de Cachan                              *
+ *                                                                           *
+ *  Verificarlo is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by     *
+ *  the Free Software Foundation, either version 3 of the License, or        *
+ *  (at your option) any later version.                                      *
+ *                                                                           *
+ *  Verificarlo is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *  GNU General Public License for more details.                             *
+ *                                                                           *
+ *  You should have received a copy of the GNU General Public License        *
+ *  along with Verificarlo.  If not, see <http://www.gnu.org/licenses/>.     *
+ *                                                                           *
+ *****************************************************************************/
+
+/* Runtime control of the instrumentation of programs compiled with
+ * verificarlo. When the instrumentation is disabled, instrumented operations
+ * run natively and do not reach the backends. */
+
+#ifndef __VFC_INSTRUMENTATION_H__
+#define __VFC_INSTRUMENTATION_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Enables or disables the instrumentation for all the threads */
+void vfc_instrumentation_enable(void);
+void vfc_instrumentation_disable(void);
+
+/* Delimits a region where the instrumentation is enabled, if the region is
+ * selected by VFC_REGIONS. Regions can be nested, vfc_region_end restores the
+ * state before the matching vfc_region_begin. The state and the stack of
+ * regions are shared by all the threads and are not synchronized: regions
+ * must only begin and end outside of parallel sections, or in one thread at
+ * a time. A region may contain parallel sections. */
+void vfc_region_begin(const char *name);
+void vfc_region_end(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VFC_INSTRUMENTATION_H__ */
@@ -0,0 +1,28 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Each of the 4 threads runs kernel, the call-site profile must count the
+   operations of all the threads. The line numbers are checked by test.sh */
+
+double kernel(long n) {
+  double sum = 0.0;
+  float prod = 1.0f;
+  for (long i = 0; i < n; i++) {
+    sum = sum + 0.5;
+    if (i % 2 == 0) {
+      prod = prod * 1.0001f;
+    }
+  }
+  return sum - prod;
+}
+
+int main(int argc, char *argv[]) {
+  long n = (argc > 1) ? atol(argv[1]) : 1000;
+  double result = 0.0;
+
+#pragma omp parallel num_threads(4) reduction(+ : result)
+  result = kernel(n);
+
+  printf("%g\n", result);
+  return 0;
+}
@@ -0,0 +1,38 @@
+#!/bin/bash
+set -e
+
+# Checks the per-call-site operation counts written to VFC_PROFILE. The
+# program is compiled without -g, the pass locates the call sites anyway.
+
+export VFC_BACKENDS_SILENT_LOAD="TRUE"
+export VFC_BACKENDS="libinterflop_ieee.so"
+
+verificarlo-c -O0 -fopenmp --function kernel test.c -o test
+
+VFC_PROFILE=profile.txt ./test 1000
+cat profile.txt
+
+check() {
+    if ! grep -q -P "^[0-9]+\t$1$" profile.txt; then
+	echo "error: missing call site \"$1\""
+	exit 1
+    fi
+}
+
+check "4000\tadd\tdouble\ttest.c:11\tkernel"
+check "2000\tmul\tfloat\ttest.c:13\tkernel"
+check "4\tsub\tdouble\ttest.c:16\tkernel"
+
+if ! head -1 profile.txt | grep -q "^# 6004 operations in 3 call sites$"; then
+    echo "error: wrong total in the profile header"
+    exit 1
+fi
+
+# Operations run natively are not counted
+VFC_INSTRUMENTATION_DISABLED=TRUE VFC_PROFILE=profile.txt ./test 1000
+if ! head -1 profile.txt | grep -q "^# 0 operations in 0 call sites$"; then
+    echo "error: operations run natively must not be counted"
+    exit 1
+fi
+
+echo "success"
@@ -19,4 +19,14 @@ else
   exit 1
 fi
 
+# Operations are located from the call-site descriptors, without debug
+# information nor addr2line
+verificarlo-c --ddebug -O0 test.c -o test_nodebug
+VFC_BACKENDS="libinterflop_ieee.so" VFC_DDEBUG_GEN="inclusion_nodebug.txt" ./test_nodebug
+cat inclusion_nodebug.txt
 
+if [ $(cat inclusion_nodebug.txt | wc -l) != $(cat inclusion.txt | wc -l) ] ||
+   grep -v -q "^0x[0-9a-f]*: .* at test.c:[1-9][0-9]* #[0-9]*$" inclusion_nodebug.txt; then
+  echo "problem with the generation without debug information"
+  exit 1
+fi
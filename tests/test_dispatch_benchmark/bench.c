@@ -0,0 +1,76 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../../src/common/interflop.h"
+
+/* Microbenchmark of the vfcwrapper dispatch. Only kernel is instrumented,
+   each iteration of its loop goes through one _doubleadd call. The same
+   loop is timed with the previous dispatch of the wrappers, which loops over
+   the backends loaded by vfcwrapper and tests their hooks for NULL. */
+
+/* Backends loaded by vfcwrapper */
+extern struct interflop_backend_interface_t backends[];
+extern void *contexts[];
+extern unsigned char loaded_backends;
+
+__attribute__((noinline)) double kernel(double x, long n) {
+  for (long i = 0; i < n; i++) {
+    x = x + 1.0;
+  }
+  return x;
+}
+
+/* _doubleadd before the dispatch tables */
+__attribute__((noinline)) double loop_doubleadd(double a, double b) {
+  double c = NAN;
+  for (unsigned char i = 0; i < loaded_backends; i++) {
+    if (backends[i].interflop_add_double) {
+      backends[i].interflop_add_double(a, b, &c, contexts[i]);
+    }
+  }
+  return c;
+}
+
+__attribute__((noinline)) double loop_kernel(double x, long n) {
+  for (long i = 0; i < n; i++) {
+    x = loop_doubleadd(x, 1.0);
+  }
+  return x;
+}
+
+static uint64_t now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+/* Times f, returns the ns/op or -1 on a wrong result */
+static double measure(double (*f)(double, long), long n) {
+  uint64_t start = now();
+  double x = f(0.0, n);
+  uint64_t elapsed = now() - start;
+
+  /* With the IEEE backend every partial sum is exact */
+  if (x != (double)n) {
+    fprintf(stderr, "wrong result: %a instead of %ld\n", x, n);
+    return -1;
+  }
+  return (double)elapsed / n;
+}
+
+int main(int argc, char *argv[]) {
+  long n = (argc > 1) ? atol(argv[1]) : 10000000;
+
+  double tables = measure(kernel, n);
+  double loop = measure(loop_kernel, n);
+  if (tables < 0 || loop < 0) {
+    return 1;
+  }
+
+  printf("%.2f ns/op (previous dispatch %.2f ns/op, gain %.0f%%)\n", tables,
+         loop, 100 * (loop - tables) / loop);
+  return 0;
+}
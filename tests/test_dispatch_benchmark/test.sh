@@ -0,0 +1,17 @@
+#!/bin/bash
+set -e
+
+# Reports the cost of one instrumented _doubleadd with the IEEE backend,
+# alone and chained twice, against the previous dispatch that looped over
+# the loaded backends. Timings are informative, the test only fails if the
+# computed sums are wrong.
+
+export VFC_BACKENDS_SILENT_LOAD="TRUE"
+
+verificarlo-c -O2 --function kernel bench.c -o bench
+
+for BACKENDS in "libinterflop_ieee.so" \
+		"libinterflop_ieee.so;libinterflop_ieee.so"; do
+    export VFC_BACKENDS="$BACKENDS"
+    echo "$BACKENDS: $(./bench 10000000)"
+done
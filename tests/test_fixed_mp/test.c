@@ -0,0 +1,130 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <mpfr.h>
+
+#include "../../src/common/fixed_mp.h"
+
+/* Checks the fixed-limb arithmetic of fixed_mp.h against MPFR at the same */
+/* precision */
+
+#define CHECKS 200000
+
+/* xorshift64 */
+static inline uint64_t next(uint64_t *x) {
+  *x ^= *x << 13;
+  *x ^= *x >> 7;
+  *x ^= *x << 17;
+  return *x;
+}
+
+/* Draws a nonzero operand, with sparse significands to produce exact */
+/* results and ties, and close exponents to produce cancellations */
+static void rand_fmp(fixed_mp *x, uint64_t *state, const int n) {
+  const uint64_t kind = next(state) % 4;
+  for (int i = 0; i < n; i++) {
+    x->m[i] = (kind == 0) ? 0 : next(state);
+  }
+  if (kind == 0) {
+    x->m[next(state) % n] = UINT64_C(1) << (next(state) % 64);
+  } else if (kind == 1) {
+    x->m[0] &= ~UINT64_C(0) << (next(state) % 64);
+  }
+  x->m[n - 1] |= FMP_LIMB_MSB;
+  x->exp = (int32_t)(next(state) % 9) - 4;
+  if (next(state) % 8 == 0) {
+    x->exp = (int32_t)(next(state) % 2200) - 1100;
+  }
+  x->sign = next(state) & 1;
+}
+
+/* Sets the MPFR object y to the exact value of x */
+static void set_mpfr(mpfr_t y, const fixed_mp *x, const int n) {
+  mpfr_set_zero(y, x->sign ? -1 : 1);
+  for (int i = 0; i < n; i++) {
+    MPFR_DECL_INIT(limb, 64);
+    mpfr_set_uj_2exp(limb, x->m[i], x->exp - (64 * n - 1) + 64 * i,
+                     MPFR_RNDN);
+    if (x->sign) {
+      mpfr_neg(limb, limb, MPFR_RNDN);
+    }
+    mpfr_add(y, y, limb, MPFR_RNDN);
+  }
+}
+
+static int check(const int n, uint64_t *state) {
+  const mpfr_prec_t prec = 64 * n;
+  mpfr_t ma, mb, mr, expected;
+  mpfr_inits2(prec, ma, mb, mr, expected, (mpfr_ptr)0);
+  int errors = 0;
+
+  for (int i = 0; i < CHECKS; i++) {
+    fixed_mp a, b, r;
+    rand_fmp(&a, state, n);
+    rand_fmp(&b, state, n);
+    if (i % 7 == 0) {
+      /* same magnitude for exact cancellations */
+      b = a;
+      b.sign = next(state) & 1;
+      b.m[0] ^= next(state) % 4;
+    }
+    set_mpfr(ma, &a, n);
+    set_mpfr(mb, &b, n);
+
+    for (int op = 0; op < 4; op++) {
+      switch (op) {
+      case 0:
+        _fmp_add(&r, &a, &b, n);
+        mpfr_add(expected, ma, mb, MPFR_RNDN);
+        break;
+      case 1:
+        _fmp_sub(&r, &a, &b, n);
+        mpfr_sub(expected, ma, mb, MPFR_RNDN);
+        break;
+      case 2:
+        _fmp_mul(&r, &a, &b, n);
+        mpfr_mul(expected, ma, mb, MPFR_RNDN);
+        break;
+      case 3:
+        _fmp_div(&r, &a, &b, n);
+        mpfr_div(expected, ma, mb, MPFR_RNDN);
+        break;
+      }
+      set_mpfr(mr, &r, n);
+      const double d = _fmp_get_d(&r, n);
+      const bool same_d = mpfr_get_d(expected, MPFR_RNDN) == d;
+      if (!mpfr_equal_p(mr, expected) ||
+          mpfr_signbit(mr) != mpfr_signbit(expected) || !same_d) {
+        if (errors++ < 10) {
+          mpfr_printf("error %d limbs, op %c: %Ra %Ra, got %Ra (%a) "
+                      "expected %Ra\n",
+                      n, "+-*/"[op], ma, mb, mr, d, expected);
+        }
+      }
+    }
+
+    /* conversions from and to binary64, including subnormals */
+    binary64 b64 = {.u64 = next(state) & DOUBLE_ERASE_SIGN};
+    if (b64.u64 < DOUBLE_PLUS_INF) {
+      _fmp_set_d(&a, b64.f64, n);
+      if (_fmp_get_d(&a, n) != b64.f64) {
+        if (errors++ < 10) {
+          printf("error %d limbs: conversion of %a\n", n, b64.f64);
+        }
+      }
+    }
+  }
+
+  mpfr_clears(ma, mb, mr, expected, (mpfr_ptr)0);
+  return errors;
+}
+
+int main(void) {
+  uint64_t state = UINT64_C(2463534242);
+  int errors = 0;
+  for (int n = 2; n <= FMP_LIMBS_MAX; n++) {
+    errors += check(n, &state);
+  }
+  return errors != 0;
+}
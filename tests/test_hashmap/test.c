@@ -0,0 +1,219 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../src/common/vfc_concurrent_map.h"
+#include "../../src/common/vfc_hashmap.h"
+
+/* Checks vfc_hashmap against the expected contents, and that threads
+ * inserting the same keys in vfc_concurrent_map agree on their values. */
+
+#define COLLIDING_BLOCKS 10
+#define THREADS 8
+#define THREAD_KEYS 100000
+
+/* Function ids as built by the function instrumentation */
+static char **make_keys(size_t n, const char *prefix) {
+  char **keys = malloc(n * sizeof(char *));
+  for (size_t i = 0; i < n; i++) {
+    keys[i] = malloc(64);
+    snprintf(keys[i], 64, "%s/src/module_%zu.c/function_%zu/%zu", prefix,
+             i % 97, i, i % 13);
+  }
+  return keys;
+}
+
+static void free_keys(char **keys, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    free(keys[i]);
+  }
+  free(keys);
+}
+
+#define CHECK(cond, ...)                                                       \
+  if (!(cond)) {                                                               \
+    if (errors++ < 10) {                                                       \
+      printf(__VA_ARGS__);                                                     \
+    }                                                                          \
+  }
+
+static int check(size_t n) {
+  int errors = 0;
+  char **keys = make_keys(n, "check");
+  vfc_hashmap_t map = vfc_hashmap_create();
+
+  for (size_t i = 0; i < n; i++) {
+    vfc_hashmap_insert(map, keys[i], keys[i]);
+  }
+  CHECK(vfc_hashmap_num_items(map) == n, "%zu keys instead of %zu\n",
+        vfc_hashmap_num_items(map), n);
+
+  /* remove one key out of two and replace the value of the others */
+  for (size_t i = 0; i < n; i += 2) {
+    vfc_hashmap_remove(map, keys[i]);
+  }
+  for (size_t i = 1; i < n; i += 2) {
+    vfc_hashmap_insert(map, keys[i], keys[i - 1]);
+  }
+  for (size_t i = 0; i < n; i++) {
+    void *expected = (i % 2) ? keys[i - 1] : NULL;
+    CHECK(vfc_hashmap_get(map, keys[i]) == expected, "wrong value for %s\n",
+          keys[i]);
+    CHECK(vfc_hashmap_have(map, keys[i]) == (i % 2), "wrong key %s\n",
+          keys[i]);
+  }
+
+  size_t found = 0;
+  for (size_t i = 0; i < map->capacity; i++) {
+    found += vfc_hashmap_value_at(map, i) != NULL;
+  }
+  CHECK(found == n / 2 && vfc_hashmap_num_items(map) == n / 2,
+        "%zu keys found, %zu counted instead of %zu\n", found,
+        vfc_hashmap_num_items(map), n / 2);
+
+  vfc_hashmap_destroy(map);
+  free_keys(keys, n);
+  return errors;
+}
+
+/* Hash of the previous implementation, which only stored the hashes of the
+ * keys and merged the keys of the same hash */
+static size_t old_str_function(const char *id) {
+  size_t index = 0;
+  for (const unsigned char *us = (const unsigned char *)id; *us != '\0'; us++) {
+    index = index * 31 + *us;
+  }
+  return index;
+}
+
+/* Strings made of "Aa" and "BB" blocks have the same hash with the
+ * multiplier 31 of the previous implementation */
+static int check_collisions(void) {
+  int errors = 0;
+  const size_t n = 1 << COLLIDING_BLOCKS;
+  char **keys = malloc(n * sizeof(char *));
+  vfc_hashmap_t map = vfc_hashmap_create();
+
+  for (size_t i = 0; i < n; i++) {
+    keys[i] = calloc(2 * COLLIDING_BLOCKS + 1, 1);
+    for (int b = 0; b < COLLIDING_BLOCKS; b++) {
+      memcpy(keys[i] + 2 * b, ((i >> b) & 1) ? "BB" : "Aa", 2);
+    }
+    vfc_hashmap_insert(map, keys[i], keys[i]);
+  }
+  CHECK(old_str_function(keys[0]) == old_str_function(keys[n - 1]),
+        "the keys %s and %s do not collide\n", keys[0], keys[n - 1]);
+  CHECK(vfc_hashmap_num_items(map) == n, "%zu colliding keys instead of %zu\n",
+        vfc_hashmap_num_items(map), n);
+  for (size_t i = 0; i < n; i++) {
+    CHECK(vfc_hashmap_get(map, keys[i]) == keys[i], "wrong value for %s\n",
+          keys[i]);
+  }
+
+  vfc_hashmap_destroy(map);
+  free_keys(keys, n);
+  return errors;
+}
+
+/* Inserting and removing keys leaves deleted slots, they must not grow the
+ * map */
+static int check_deleted(void) {
+  int errors = 0;
+  const size_t n = 100000;
+  char **keys = make_keys(n, "deleted");
+  vfc_hashmap_t map = vfc_hashmap_create();
+
+  for (size_t i = 0; i < n; i++) {
+    vfc_hashmap_insert(map, keys[i], keys[i]);
+    if (i >= 16) {
+      vfc_hashmap_remove(map, keys[i - 16]);
+    }
+  }
+  CHECK(vfc_hashmap_num_items(map) == 16 && map->capacity <= 64,
+        "%zu keys in %zu slots instead of 16 in 64\n",
+        vfc_hashmap_num_items(map), map->capacity);
+  for (size_t i = n - 16; i < n; i++) {
+    CHECK(vfc_hashmap_get(map, keys[i]) == keys[i], "wrong value for %s\n",
+          keys[i]);
+  }
+
+  vfc_hashmap_destroy(map);
+  free_keys(keys, n);
+  return errors;
+}
+
+typedef struct {
+  vfc_concurrent_map_t map;
+  char **keys;
+  int thread;
+  void **added;
+} thread_args_t;
+
+/* Each thread gets or inserts all the keys, starting at a different key, and
+ * records the value of each key in the map */
+static void *insert_keys(void *arg) {
+  thread_args_t *args = (thread_args_t *)arg;
+  for (size_t j = 0; j < THREAD_KEYS; j++) {
+    const size_t i = (j + args->thread * THREAD_KEYS / THREADS) % THREAD_KEYS;
+    void *value = vfc_concurrent_map_get(args->map, args->keys[i]);
+    if (value == NULL) {
+      value = vfc_concurrent_map_insert(args->map, args->keys[i],
+                                        &args->added[i]);
+    }
+    args->added[i] = value;
+  }
+  /* lookups only */
+  for (size_t i = 0; i < THREAD_KEYS; i++) {
+    if (vfc_concurrent_map_get(args->map, args->keys[i]) != args->added[i]) {
+      args->added[i] = NULL;
+    }
+  }
+  return NULL;
+}
+
+static int check_concurrent(void) {
+  int errors = 0;
+  char **keys = make_keys(THREAD_KEYS, "concurrent");
+  vfc_concurrent_map_t map = vfc_concurrent_map_create();
+  pthread_t threads[THREADS];
+  thread_args_t args[THREADS];
+
+  for (int t = 0; t < THREADS; t++) {
+    args[t] = (thread_args_t){map, keys, t,
+                              calloc(THREAD_KEYS, sizeof(void *))};
+    pthread_create(&threads[t], NULL, insert_keys, &args[t]);
+  }
+  for (int t = 0; t < THREADS; t++) {
+    pthread_join(threads[t], NULL);
+  }
+
+  CHECK(vfc_concurrent_map_num_items(map) == THREAD_KEYS,
+        "%zu keys in the concurrent map instead of %d\n",
+        vfc_concurrent_map_num_items(map), THREAD_KEYS);
+  for (size_t i = 0; i < THREAD_KEYS; i++) {
+    void *value = vfc_concurrent_map_get(map, keys[i]);
+    for (int t = 0; t < THREADS; t++) {
+      CHECK(args[t].added[i] == value, "thread %d disagrees on %s\n", t,
+            keys[i]);
+    }
+  }
+  for (int t = 0; t < THREADS; t++) {
+    free(args[t].added);
+  }
+
+  vfc_concurrent_map_destroy(map);
+  free_keys(keys, THREAD_KEYS);
+  return errors;
+}
+
+int main(void) {
+  int errors = 0;
+  for (size_t n = 1; n <= 1000000; n *= 10) {
+    errors += check(n);
+  }
+  errors += check_collisions();
+  errors += check_deleted();
+  errors += check_concurrent();
+  return errors != 0;
+}
@@ -0,0 +1,23 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Runs the same instrumented kernel in a program that loads its backend at
+   runtime and in a program where it is inlined. The results are printed
+   to compare both programs. */
+
+__attribute__((noinline)) double kernel(long n) {
+  double sum = 0.0;
+  float prod = 1.0f;
+  for (long i = 1; i <= n; i++) {
+    sum = sum + 1.0 / (double)i;
+    prod = prod * 1.000001f;
+  }
+  return sum - prod;
+}
+
+int main(int argc, char *argv[]) {
+  long n = (argc > 1) ? atol(argv[1]) : 1000000;
+
+  printf("%a\n", kernel(n));
+  return 0;
+}
@@ -0,0 +1,45 @@
+#!/bin/bash
+set -e
+
+# Programs compiled with --inline-backend must give the same results as
+# programs loading the backend at runtime.
+
+export VFC_BACKENDS_SILENT_LOAD="TRUE"
+
+verificarlo-c -O2 --function kernel test.c -o test_dlopen
+
+for BACKEND in "ieee" \
+	       "mca --precision-binary64=40 --seed=42" \
+	       "sr --seed=42" \
+	       "vprec --precision-binary64=30 --precision-binary32=15"; do
+    NAME=${BACKEND%% *}
+    OPTIONS=${BACKEND#$NAME}
+    echo "Checking backend ${NAME}"
+
+    # one step compilation, and separate compilation and link
+    verificarlo-c -O2 --function kernel --inline-backend=$NAME test.c -o test_inline
+    verificarlo-c -O2 --function kernel --inline-backend=$NAME -c test.c -o test_inline.o
+    verificarlo-c --inline-backend=$NAME test_inline.o -o test_inline_separate
+
+    export VFC_BACKENDS="libinterflop_${NAME}.so ${OPTIONS}"
+    ./test_dlopen > out_dlopen
+    ./test_inline > out_inline
+    ./test_inline_separate > out_inline_separate
+    if ! diff -q out_dlopen out_inline || ! diff -q out_dlopen out_inline_separate; then
+	echo "error: inlined backend ${NAME} results differ"
+	exit 1
+    fi
+done
+
+# The inlined backend cannot be replaced at runtime
+export VFC_BACKENDS="libinterflop_ieee.so"
+if ./test_inline 2> /dev/null; then
+    echo "error: VFC_BACKENDS must name the inlined backend"
+    exit 1
+fi
+
+# Without VFC_BACKENDS the inlined backend runs with its default options
+unset VFC_BACKENDS
+./test_inline > /dev/null
+
+echo "success"
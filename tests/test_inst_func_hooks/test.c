@@ -0,0 +1,20 @@
+#include <math.h>
+#include <stdio.h>
+
+int helper(int a) { return a + 1; }
+
+double square(double x) { return x * x; }
+
+int main(void) {
+  double s = 0;
+  int k = 0;
+  for (int i = 0; i < 3; i++) {
+    s += square(i + 0.5);
+    s += pow(s, 0.5);
+    k = helper(k);
+  }
+  s += pow(s, 1.5);
+  printf("%d %.17g\n", k, s);
+  printf("%.17g\n", s);
+  return 0;
+}
@@ -0,0 +1,55 @@
+#!/bin/bash
+set -e
+
+# The function instrumentation emits one hook per callee and argument types,
+# shared by its call sites, and leaves the calls without floating point
+# values untouched. The ids of the call sites, which number the skipped calls
+# too, and the number of calls of each site must be kept in the VPREC output.
+
+export VFC_BACKENDS_SILENT_LOAD="TRUE"
+
+verificarlo-c -O0 test.c -o reference
+verificarlo-c -O0 --inst-func test.c -o test
+
+count_hooks() {
+    nm test | awk '{print $NF}' | grep -c "^vfc_$1_hook" || true
+}
+
+# both calls of pow share a hook, the two calls of printf differ by the type
+# of their arguments
+for HOOK in "square 1" "pow 1" "printf 2" "helper 0"; do
+    set -- $HOOK
+    if [ "$(count_hooks $1)" != "$2" ]; then
+	echo "error: $(count_hooks $1) hooks of $1 instead of $2"
+	exit 1
+    fi
+done
+
+VFC_BACKENDS="libinterflop_ieee.so" ./reference > reference.txt
+
+rm -f output.txt
+export VFC_BACKENDS="libinterflop_vprec.so --instrument=all --prec-output-file=output.txt"
+./test > test.txt
+
+if ! diff -q reference.txt test.txt; then
+    echo "error: function instrumentation changed the results"
+    exit 1
+fi
+
+# id and number of calls of each call site, helper_14_4 is not instrumented
+cat > expected.txt <<EOF
+test.c/main_8_1 1
+test.c/pow_13_3 3
+test.c/pow_16_5 1
+test.c/printf_17_6 1
+test.c/printf_18_7 1
+test.c/square_12_2 3
+EOF
+awk '/^test.c/ {print $1, $NF}' output.txt | LC_ALL=C sort > calls.txt
+
+if ! diff calls.txt expected.txt; then
+    echo "error: wrong call sites in the VPREC output file"
+    exit 1
+fi
+
+echo "success"
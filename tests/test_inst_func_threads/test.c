@@ -0,0 +1,32 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Deeper than the fixed call stack of 4096 functions used before */
+#define DEPTH 10000
+
+double depth_sum(double x, int depth) {
+  if (depth == 0) {
+    return x;
+  }
+  return x + depth_sum(x * 0.5 + 1, depth - 1);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: ./test threads\n");
+    return 1;
+  }
+  const int threads = atoi(argv[1]);
+  double *results = malloc(threads * sizeof(double));
+
+#pragma omp parallel for num_threads(threads)
+  for (int t = 0; t < threads; t++) {
+    results[t] = depth_sum(t, DEPTH);
+  }
+
+  for (int t = 0; t < threads; t++) {
+    printf("%d %.17g\n", t, results[t]);
+  }
+  free(results);
+  return 0;
+}
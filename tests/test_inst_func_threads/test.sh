@@ -0,0 +1,34 @@
+#!/bin/bash
+set -e
+
+# Each thread recurses deeper than the previous fixed-size call stack and
+# calls the VPREC function hooks with its own call stack. VPREC at full
+# precision must give the results of the uninstrumented program.
+
+export VFC_BACKENDS_SILENT_LOAD="TRUE"
+
+THREADS=4
+
+verificarlo-c -O0 -fopenmp test.c -o reference
+verificarlo-c -O0 -fopenmp --inst-func test.c -o test
+
+VFC_BACKENDS="libinterflop_ieee.so" ./reference $THREADS > reference.txt
+
+for MODE in "ib" "ob" "full"; do
+    echo "Checking VPREC mode ${MODE}"
+    rm -f output.txt
+    export VFC_BACKENDS="libinterflop_vprec.so --mode=${MODE} --instrument=all --prec-output-file=output.txt"
+    ./test $THREADS > test.txt
+
+    if ! diff -q reference.txt test.txt; then
+	echo "error: function instrumentation changed the results"
+	exit 1
+    fi
+
+    if ! grep -q "depth_sum" output.txt; then
+	echo "error: depth_sum is missing from the VPREC output file"
+	exit 1
+    fi
+done
+
+echo "success"
@@ -0,0 +1,42 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Only phase is instrumented, it runs outside of any region and in the
+   regions a and b. Each run reports if it was instrumented by comparing
+   its result with the same sum computed natively in main. */
+
+void vfc_region_begin(const char *name);
+void vfc_region_end(void);
+
+__attribute__((noinline)) double phase(long n) {
+  double sum = 0.0;
+  for (long i = 0; i < n; i++) {
+    sum = sum + 0.1;
+  }
+  return sum;
+}
+
+static void report(const char *name, double x, double reference) {
+  printf("%s %s\n", name, (x == reference) ? "native" : "instrumented");
+}
+
+int main(int argc, char *argv[]) {
+  long n = (argc > 1) ? atol(argv[1]) : 1000;
+
+  double reference = 0.0;
+  for (long i = 0; i < n; i++) {
+    reference += 0.1;
+  }
+
+  report("outside", phase(n), reference);
+
+  vfc_region_begin("a");
+  report("a", phase(n), reference);
+  vfc_region_end();
+
+  vfc_region_begin("b");
+  report("b", phase(n), reference);
+  vfc_region_end();
+
+  return 0;
+}
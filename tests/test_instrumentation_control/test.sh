@@ -0,0 +1,33 @@
+#!/bin/bash
+set -e
+
+# Checks which runs of an instrumented function reach the backend depending
+# on VFC_INSTRUMENTATION_DISABLED, VFC_REGIONS and the region calls.
+
+export VFC_BACKENDS_SILENT_LOAD="TRUE"
+export VFC_BACKENDS="libinterflop_mca.so --precision-binary64=10 --seed=42"
+
+verificarlo-c -O2 --function phase test.c -o test
+
+check() {
+    if [ "$(./test)" != "$(echo -e "$1")" ]; then
+	echo "error: expected"
+	echo -e "$1"
+	echo "got"
+	./test
+	exit 1
+    fi
+}
+
+check "outside instrumented\na instrumented\nb instrumented"
+
+export VFC_INSTRUMENTATION_DISABLED="TRUE"
+check "outside native\na instrumented\nb instrumented"
+
+export VFC_REGIONS="b,c"
+check "outside native\na native\nb instrumented"
+
+unset VFC_INSTRUMENTATION_DISABLED
+check "outside instrumented\na instrumented\nb instrumented"
+
+echo "success"
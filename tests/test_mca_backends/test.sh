@@ -19,8 +19,9 @@ Check() {
     TYPE=$3
     START_PREC=$2
     MAX_PREC=$1
+    STEP=${4:-5}
     for MODE in "PB" "RR" "MCA" ; do
-	for PREC in $(seq $START_PREC 5 $MAX_PREC) ; do
+	for PREC in $(seq $START_PREC $STEP $MAX_PREC) ; do
 	    echo "Checking at PRECISION $PREC MODE $MODE"
 	    rm -f out_mpfr out_quad
 	    export VFC_BACKENDS="libinterflop_mca_mpfr.so ${options[$3]}=$PREC --mode $MODE --seed=$SEED"
@@ -29,17 +30,21 @@ Check() {
 	    # we must remove the negative sign to not break the diff comparison
 	    sed -i "s\-nan\nan\g" out_mpfr
 
-	    export VFC_BACKENDS="libinterflop_mca.so ${options[$3]}=$PREC --mode $MODE --seed=$SEED"
-	    ./test > out_quad
-	    sed -i "s\-nan\nan\g" out_quad
-
-	    diff out_mpfr out_quad > log
-	    if [ $? -ne 0 ] ; then
-		echo "error"
-		exit 1
-	    else
-		echo "ok for precision $PREC"
-	    fi
+	    # binary64 operations use double-double intermediates by default,
+	    # --binary64-quad checks the binary128 path
+	    for PATH_OPTION in "" "--binary64-quad" ; do
+		export VFC_BACKENDS="libinterflop_mca.so ${options[$3]}=$PREC --mode $MODE --seed=$SEED $PATH_OPTION"
+		./test > out_quad
+		sed -i "s\-nan\nan\g" out_quad
+
+		diff out_mpfr out_quad > log
+		if [ $? -ne 0 ] ; then
+		    echo "error $PATH_OPTION"
+		    exit 1
+		else
+		    echo "ok for precision $PREC $PATH_OPTION"
+		fi
+	    done
 	done
     done
 }
@@ -57,4 +62,8 @@ for op in "+" "-" "*" "/" ; do
     verificarlo-c -D REAL=double -D SAMPLES=100 -D OPERATION="$op" -O0 test.c -o test
     check_status
     Check 53 3 double
+
+    # precisions above binary128 use fixed-limb intermediates in the
+    # MCA backend
+    Check 255 113 double 13
 done
@@ -0,0 +1,46 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../src/common/float_utils.h"
+#include "../../src/common/tinymt64.h"
+
+/* Checks that the MCA noise built from random bits without multiplication */
+/* is bit for bit the noise computed with the floating-point formula */
+
+#define CHECKS 10000000
+
+/* Former noise: (u - 0.5) * 2^exp computed with a multiplication */
+static inline double _noise_formula_binary64(const uint64_t r,
+                                             const int32_t exp) {
+  return _fast_pow2_binary64(exp) * (tinymt64_uint64_to_doubleOO(r) - 0.5);
+}
+
+static inline __float128 _noise_formula_binary128(const uint64_t r,
+                                                  const int32_t exp) {
+  return _fast_pow2_binary128(exp) *
+         ((__float128)tinymt64_uint64_to_doubleOO(r) - 0.5Q);
+}
+
+int main(void) {
+  tinymt64_t random_state = {.mat1 = 0, .mat2 = 0, .tmat = 0};
+  tinymt64_init(&random_state, 42);
+
+  int errors = 0;
+  for (int i = 0; i < CHECKS; i++) {
+    const uint64_t r = tinymt64_generate_uint64(&random_state);
+    /* binary64 noises perturb binary32 values and binary128 noises */
+    /* binary64 values, see _noise_binary64 and _noise_binary128 */
+    const int32_t e64 = (int32_t)(r % 600) - 300;
+    const int32_t e128 = (int32_t)(r % 4400) - 2200;
+    const double n64 = _noise_from_bits_binary64(r, e64);
+    const __float128 n128 = _noise_from_bits_binary128(r, e128);
+    if (n64 != _noise_formula_binary64(r, e64) ||
+        n128 != _noise_formula_binary128(r, e128)) {
+      fprintf(stderr, "noise mismatch for bits %016" PRIx64 "\n", r);
+      errors++;
+    }
+  }
+
+  return (errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
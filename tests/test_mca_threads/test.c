@@ -0,0 +1,39 @@
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_THREADS 64
+
+/* Each thread accumulates n times 0.1. Only kernel is instrumented, so
+   every iteration draws one random number from the thread's generator. */
+
+__attribute__((noinline)) double kernel(long n) {
+  double s = 0.0;
+  for (long i = 0; i < n; i++) {
+    s = s + 0.1;
+  }
+  return s;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s threads iterations\n", argv[0]);
+    return 1;
+  }
+  int threads = atoi(argv[1]);
+  long n = atol(argv[2]);
+  double sums[MAX_THREADS];
+
+  if (threads < 1 || threads > MAX_THREADS) {
+    fprintf(stderr, "threads must be in [1,%d]\n", MAX_THREADS);
+    return 1;
+  }
+
+#pragma omp parallel num_threads(threads)
+  sums[omp_get_thread_num()] = kernel(n);
+
+  for (int t = 0; t < threads; t++) {
+    printf("%d %a\n", t, sums[t]);
+  }
+  return 0;
+}
@@ -0,0 +1,45 @@
+#!/bin/bash
+set -e
+
+# Each thread draws from its own random generator, tinymt64 or philox.
+# The test fails if two runs with the same seed differ or if two runs with
+# different seeds match.
+
+export VFC_BACKENDS_SILENT_LOAD="TRUE"
+
+ITERATIONS=100000
+MAX_THREADS=$(nproc)
+
+verificarlo-c -O0 -fopenmp --function kernel test.c -o test
+
+for RNG in "tinymt64" "philox"; do
+for BACKEND in "libinterflop_mca.so --precision-binary64=40 --rng=$RNG" \
+	       "libinterflop_bitmask.so --operator=rand --precision-binary64=40 --rng=$RNG" \
+	       "libinterflop_sr.so --rng=$RNG" \
+	       "libinterflop_cancellation.so --rng=$RNG"; do
+    echo "Checking backend ${BACKEND}"
+
+    export VFC_BACKENDS="${BACKEND} --seed=42"
+    ./test $MAX_THREADS $ITERATIONS > out_seed_42.1
+    ./test $MAX_THREADS $ITERATIONS > out_seed_42.2
+    if ! diff -q out_seed_42.1 out_seed_42.2; then
+	echo "error: same seed must give the same per-thread results"
+	exit 1
+    fi
+
+    # Sums of positive numbers do not cancel, the cancellation backend
+    # leaves them untouched whatever the seed
+    if [[ "$BACKEND" == *cancellation* ]]; then
+	continue
+    fi
+
+    export VFC_BACKENDS="${BACKEND} --seed=43"
+    ./test $MAX_THREADS $ITERATIONS > out_seed_43
+    if diff -q out_seed_42.1 out_seed_43; then
+	echo "error: different seeds must give different results"
+	exit 1
+    fi
+done
+done
+
+echo "success"
@@ -0,0 +1,22 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Only add is instrumented. With a low MCA precision, the operations sent
+   to the backend almost never match the native sum computed in main, which
+   counts them. */
+
+__attribute__((noinline)) double add(double a, double b) { return a + b; }
+
+int main(int argc, char *argv[]) {
+  long n = (argc > 1) ? atol(argv[1]) : 1000000;
+  long sampled = 0;
+
+  for (long i = 0; i < n; i++) {
+    double a = 1.0 + i * 1e-7;
+    if (add(a, 0.3) != a + 0.3) {
+      sampled++;
+    }
+  }
+  printf("%ld\n", sampled);
+  return 0;
+}
@@ -0,0 +1,45 @@
+#!/bin/bash
+set -e
+
+# Counts the operations sent to the backend out of 1000000 with
+# VFC_SAMPLE_PERIOD and VFC_SAMPLE_RATE.
+
+export VFC_BACKENDS_SILENT_LOAD="TRUE"
+export VFC_BACKENDS="libinterflop_mca.so --precision-binary64=10 --seed=42"
+
+verificarlo-c -O2 --function add test.c -o test
+
+check() {
+    SAMPLED=$(./test)
+    echo "$1: $SAMPLED sampled operations"
+    if [ $SAMPLED -lt $2 ] || [ $SAMPLED -gt $3 ]; then
+	echo "error: expected between $2 and $3"
+	exit 1
+    fi
+}
+
+check "no sampling" 990000 1000000
+
+export VFC_SAMPLE_PERIOD=1
+check "period 1" 990000 1000000
+
+export VFC_SAMPLE_PERIOD=100
+check "period 100" 9900 10000
+
+unset VFC_SAMPLE_PERIOD
+export VFC_SAMPLE_RATE=0.05
+check "rate 0.05" 48000 52000
+
+# 2/p - 1 is not an integer, truncated intervals would sample about 298200
+export VFC_SAMPLE_RATE=0.3
+check "rate 0.3" 299000 301000
+
+# The sampled operations do not depend on the run
+./test > out.1
+./test > out.2
+if ! diff -q out.1 out.2; then
+    echo "error: sampling with the same seed must give the same results"
+    exit 1
+fi
+
+echo "success"
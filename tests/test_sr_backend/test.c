@@ -0,0 +1,71 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Only operate is instrumented, the checks are computed in long double */
+/* which holds the exact sums and products of the binary32 operands and */
+/* is accurate enough to place the binary64 results between neighbours */
+
+#define SAMPLES 10000
+#define TESTS 32
+
+#define STR(X) #X
+#define XSTR(X) STR(X)
+
+#define NEXTAFTER(X, Y)                                                        \
+  _Generic((X), double : nextafter, float : nextafterf)(X, Y)
+
+REAL operate(REAL a, REAL b) { return a OPERATION b; }
+
+long double exact(long double a, long double b) { return a OPERATION b; }
+
+REAL get_rand(void) {
+  return (REAL)(drand48() - 0.5) * ldexp(1.0, (int)(lrand48() % 40) - 20);
+}
+
+/* Returns 1 if the results of a OPERATION b are not distributed as */
+/* expected with stochastic rounding */
+static int do_test(REAL a, REAL b) {
+  const long double x = exact(a, b);
+  REAL down = (REAL)x;
+  if (down > x) {
+    down = NEXTAFTER(down, -INFINITY);
+  }
+  REAL up = (down == x) ? down : NEXTAFTER(down, INFINITY);
+
+  /* The result is rounded up with probability (x - down) / (up - down) */
+  const double expected = (up == down) ? 1.0 : (x - down) / (up - down);
+  int count_up = 0;
+  for (int i = 0; i < SAMPLES; i++) {
+    const REAL r = operate(a, b);
+    if (r != down && r != up) {
+      fprintf(stderr,
+              "%a " XSTR(OPERATION) " %a: %a is not a neighbour of %La\n", a,
+              b, r, x);
+      return 1;
+    }
+    count_up += (r == up);
+  }
+
+  /* Five standard deviations of the frequency at most */
+  const double frequency = (double)count_up / SAMPLES;
+  if (fabs(frequency - expected) > 5 * 0.5 / sqrt(SAMPLES)) {
+    fprintf(stderr,
+            "%a " XSTR(OPERATION) " %a: rounded up with frequency %f, "
+                                  "expected %f\n",
+            a, b, frequency, expected);
+    return 1;
+  }
+  return 0;
+}
+
+int main(void) {
+  int errors = 0;
+  srand48(0);
+  for (int i = 0; i < TESTS; i++) {
+    errors += do_test(get_rand(), get_rand());
+  }
+  /* Exact operations are never perturbed */
+  errors += do_test(1.5, 0.25);
+  return (errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,24 @@
+#!/bin/bash
+set -e
+
+# Checks that the SR backend only returns the two floating-point neighbours
+# of the exact result and rounds up with a frequency matching the distance
+# to the lower neighbour, for every operation and precision
+
+export VFC_BACKENDS_SILENT_LOAD="TRUE"
+
+for REAL in float double; do
+for OP in "+" "-" "*" "/"; do
+    verificarlo-c -O0 -D REAL=$REAL -D OPERATION="$OP" --function operate test.c -o test -lm
+    for RNG in "tinymt64" "philox"; do
+	echo "Checking ${REAL} ${OP} with ${RNG}"
+	export VFC_BACKENDS="libinterflop_sr.so --rng=$RNG --seed=42"
+	if ! ./test; then
+	    echo "error: wrong stochastic rounding distribution"
+	    exit 1
+	fi
+    done
+done
+done
+
+echo "success"
@@ -0,0 +1,50 @@
+#include <stdio.h>
+
+typedef float float2 __attribute__((ext_vector_type(2)));
+typedef float float4 __attribute__((ext_vector_type(4)));
+typedef float float16 __attribute__((ext_vector_type(16)));
+typedef double double2 __attribute__((ext_vector_type(2)));
+typedef double double3 __attribute__((ext_vector_type(3)));
+typedef double double4 __attribute__((ext_vector_type(4)));
+typedef double double8 __attribute__((ext_vector_type(8)));
+
+#define PRINT(X, N)                                                            \
+  do {                                                                         \
+    for (int i = 0; i < N; i++)                                                \
+      printf("%a ", (double)X[i]);                                             \
+    printf("\n");                                                              \
+  } while (0)
+
+#define TEST(TYPE, N, A, B)                                                    \
+  do {                                                                         \
+    TYPE a = A;                                                                \
+    TYPE b = B;                                                                \
+    TYPE c;                                                                    \
+    c = a + b;                                                                 \
+    PRINT(c, N);                                                               \
+    c = a - b;                                                                 \
+    PRINT(c, N);                                                               \
+    c = a * b;                                                                 \
+    PRINT(c, N);                                                               \
+    c = a / b;                                                                 \
+    PRINT(c, N);                                                               \
+  } while (0)
+
+int main(void) {
+  TEST(float2, 2, ((float2){0.1f, 1e-8f}), ((float2){3.0f, 7.0f}));
+  TEST(float4, 4, ((float4){0.1f, 1e-8f, 5.0f, -3.0f}),
+       ((float4){3.0f, 7.0f, 0.3f, 1e10f}));
+  TEST(float16, 16,
+       ((float16){0.1f, 1e-8f, 5.0f, -3.0f, 0.1f, 1e-8f, 5.0f, -3.0f, 0.1f,
+                  1e-8f, 5.0f, -3.0f, 0.1f, 1e-8f, 5.0f, -3.0f}),
+       ((float16){3.0f, 7.0f, 0.3f, 1e10f, 7.0f, 0.3f, 1e10f, 3.0f, 0.3f,
+                  1e10f, 3.0f, 7.0f, 1e10f, 3.0f, 7.0f, 0.3f}));
+  TEST(double2, 2, ((double2){0.1, 1e-300}), ((double2){3.0, 7.0}));
+  TEST(double3, 3, ((double3){0.1, 1e-300, 5.0}), ((double3){3.0, 7.0, 0.3}));
+  TEST(double4, 4, ((double4){0.1, 1e-300, 5.0, -3.0}),
+       ((double4){3.0, 7.0, 0.3, 1e100}));
+  TEST(double8, 8,
+       ((double8){0.1, 1e-300, 5.0, -3.0, 0.1, 1e-300, 5.0, -3.0}),
+       ((double8){3.0, 7.0, 0.3, 1e100, 7.0, 0.3, 1e100, 3.0}));
+  return 0;
+}
@@ -0,0 +1,44 @@
+#!/bin/bash
+set -e
+
+# Checks that vector operations of any width are instrumented and that
+# backends with and without vector hooks compute the same results in IEEE mode
+
+export VFC_BACKENDS_SILENT_LOAD="TRUE"
+
+verificarlo-c -O0 test.c -o test
+
+# Native operations are only kept behind the vfc_instrumentation_enabled
+# guard, one for each helper call
+for op in add sub mul div; do
+    native=$(grep -c "= f$op " test.2.ll || true)
+    calls=$(grep -c "call .*@_[0-9nx]*\(float\|double\)$op(" test.2.ll || true)
+    if [ "$native" != "$calls" ]; then
+	echo "Some f$op have not been instrumented"
+	exit 1
+    fi
+done
+
+# Vectors wider than 128 bits go through the width-generic wrappers
+for width in 3 4 8 16; do
+    if ! grep -q "_nx.*(i32 $width," test.2.ll; then
+	echo "No width-generic call for vectors of $width elements"
+	exit 1
+    fi
+done
+
+VFC_BACKENDS="libinterflop_ieee.so" ./test > ref
+
+for BACKENDS in "libinterflop_mca.so --mode=ieee" \
+		"libinterflop_bitmask.so --mode=ieee" \
+		"libinterflop_mca_mpfr.so --mode=ieee" \
+		"libinterflop_ieee.so;libinterflop_mca.so --mode=ieee"; do
+    echo "Checking $BACKENDS"
+    VFC_BACKENDS="$BACKENDS" ./test > out
+    if ! diff ref out; then
+	echo "Results differ from the IEEE backend"
+	exit 1
+    fi
+done
+
+echo "success"